@@ -0,0 +1,270 @@
+// Micro benchmarks for bseecs.
+//
+// Build with optimizations, e.g.:
+//   g++ -O2 -std=c++17 -pthread Benchmark.cpp -o bseecs_bench
+#include "beecs.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+struct A {
+	float x = 1.0f;
+};
+
+struct B {
+	float y = 2.0f;
+};
+
+struct C {
+	float z = 3.0f;
+};
+
+// Component owning heap memory, costly to copy
+struct Inventory {
+	std::vector<int> items;
+};
+
+// Same layout, stored as an array of structs and as a structure of arrays
+struct BodyAoS {
+	float x = 0.0f, y = 0.0f, z = 0.0f;
+	float vx = 1.0f, vy = 2.0f, vz = 3.0f;
+	float mass = 1.0f, drag = 0.5f;
+};
+
+struct BodySoA {
+	float x = 0.0f, y = 0.0f, z = 0.0f;
+	float vx = 1.0f, vy = 2.0f, vz = 3.0f;
+	float mass = 1.0f, drag = 0.5f;
+};
+
+namespace bseecs {
+
+	template <>
+	struct ComponentTraits<BodySoA> : DefaultComponentTraits<BodySoA> {
+		using Storage = SoAStorage<BodySoA, &BodySoA::x, &BodySoA::y, &BodySoA::z,
+			&BodySoA::vx, &BodySoA::vy, &BodySoA::vz, &BodySoA::mass, &BodySoA::drag>;
+	};
+
+}
+
+namespace {
+
+	using Clock = std::chrono::steady_clock;
+
+	constexpr size_t ENTITY_COUNT = 1'000'000;
+	constexpr int ITERATIONS = 10;
+
+	template <typename Func>
+	double MeasureMs(Func&& func) {
+		auto start = Clock::now();
+		func();
+		std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+		return elapsed.count();
+	}
+
+	void BenchForEachABC() {
+		bseecs::ECS ecs;
+		ecs.RegisterComponent<A>();
+		ecs.RegisterComponent<B>();
+		ecs.RegisterComponent<C>();
+
+		for (size_t i = 0; i < ENTITY_COUNT; i++) {
+			bseecs::EntityID id = ecs.CreateEntity();
+			ecs.Add<A>(id);
+			ecs.Add<B>(id);
+			ecs.Add<C>(id);
+		}
+
+		float sum = 0.0f;
+		double total = 0.0;
+		for (int i = 0; i < ITERATIONS; i++) {
+			total += MeasureMs([&]() {
+				ecs.ForEach<A, B, C>([&sum](A& a, B& b, C& c) {
+					a.x += b.y * c.z;
+					sum += a.x;
+				});
+			});
+		}
+
+		std::printf("ForEach<A, B, C> over %zu entities: %.3f ms/iter (checksum %f)\n",
+			ENTITY_COUNT, total / ITERATIONS, sum);
+	}
+
+	void BenchForEachChunkABC() {
+		bseecs::ECS ecs;
+		ecs.RegisterComponent<A>();
+		ecs.RegisterComponent<B>();
+		ecs.RegisterComponent<C>();
+		ecs.Group<A, B, C>();
+
+		for (size_t i = 0; i < ENTITY_COUNT; i++) {
+			bseecs::EntityID id = ecs.CreateEntity();
+			ecs.Add<A>(id);
+			ecs.Add<B>(id);
+			ecs.Add<C>(id);
+		}
+
+		double total = 0.0;
+		for (int i = 0; i < ITERATIONS; i++) {
+			total += MeasureMs([&]() {
+				ecs.ForEachChunk<A, const B, const C>([](bseecs::Span<A> a, bseecs::Span<const B> b, bseecs::Span<const C> c) {
+					for (size_t j = 0; j < a.size(); j++)
+						a[j].x += b[j].y * c[j].z;
+				});
+			});
+		}
+
+		std::printf("ForEachChunk<A, B, C> over %zu grouped entities: %.3f ms/iter\n",
+			ENTITY_COUNT, total / ITERATIONS);
+	}
+
+	void BenchParallelForEachABC() {
+		bseecs::ECS ecs;
+		ecs.RegisterComponent<A>();
+		ecs.RegisterComponent<B>();
+		ecs.RegisterComponent<C>();
+
+		for (size_t i = 0; i < ENTITY_COUNT; i++) {
+			bseecs::EntityID id = ecs.CreateEntity();
+			ecs.Add<A>(id);
+			ecs.Add<B>(id);
+			ecs.Add<C>(id);
+		}
+
+		for (size_t threads : { 1, 2, 4, 8, 16 }) {
+			ecs.SetThreadCount(threads);
+
+			double total = 0.0;
+			for (int i = 0; i < ITERATIONS; i++) {
+				total += MeasureMs([&]() {
+					ecs.ParallelForEach<A, B, C>([](A& a, B& b, C& c) {
+						a.x += b.y * c.z;
+					});
+				});
+			}
+
+			std::printf("ParallelForEach<A, B, C> over %zu entities, %zu threads: %.3f ms/iter\n",
+				ENTITY_COUNT, threads, total / ITERATIONS);
+		}
+	}
+
+	void BenchHeapComponentChurn() {
+		constexpr size_t CHURN_COUNT = 100'000;
+		constexpr size_t ITEM_COUNT = 32;
+
+		bseecs::ECS ecs;
+		ecs.RegisterComponent<Inventory>();
+
+		double total = 0.0;
+		for (int i = 0; i < ITERATIONS; i++) {
+			total += MeasureMs([&]() {
+				std::vector<bseecs::EntityID> ids;
+				ids.reserve(CHURN_COUNT);
+				for (size_t j = 0; j < CHURN_COUNT; j++) {
+					bseecs::EntityID id = ecs.CreateEntity();
+					ecs.Emplace<Inventory>(id, std::vector<int>(ITEM_COUNT, int(j)));
+					ids.push_back(id);
+				}
+
+				// Every deletion but the last moves an element into the hole
+				for (bseecs::EntityID& id : ids)
+					ecs.DeleteEntity(id);
+			});
+		}
+
+		std::printf("Emplace + DeleteEntity of %zu heap owning components: %.3f ms/iter\n",
+			CHURN_COUNT, total / ITERATIONS);
+	}
+
+	void BenchIntegrateAoSvsSoA() {
+		bseecs::ECS ecs;
+		ecs.RegisterComponent<BodyAoS>();
+		ecs.RegisterComponent<BodySoA>();
+
+		for (size_t i = 0; i < ENTITY_COUNT; i++) {
+			bseecs::EntityID id = ecs.CreateEntity();
+			ecs.Add<BodyAoS>(id);
+			ecs.Add<BodySoA>(id);
+		}
+
+		double aos = 0.0;
+		double soa = 0.0;
+		for (int i = 0; i < ITERATIONS; i++) {
+			aos += MeasureMs([&]() {
+				ecs.ForEach<BodyAoS>([](BodyAoS& body) {
+					body.x += body.vx;
+					body.y += body.vy;
+					body.z += body.vz;
+				});
+			});
+
+			soa += MeasureMs([&]() {
+				ecs.ForEachFields<BodySoA, &BodySoA::x, &BodySoA::y, &BodySoA::z, &BodySoA::vx, &BodySoA::vy, &BodySoA::vz>(
+					[](bseecs::Span<float> x, bseecs::Span<float> y, bseecs::Span<float> z,
+						bseecs::Span<const float> vx, bseecs::Span<const float> vy, bseecs::Span<const float> vz) {
+					for (size_t j = 0; j < x.size(); j++) {
+						x[j] += vx[j];
+						y[j] += vy[j];
+						z[j] += vz[j];
+					}
+				});
+			});
+		}
+
+		std::printf("Integrate %zu bodies: AoS ForEach %.3f ms/iter, SoA ForEachFields %.3f ms/iter\n",
+			ENTITY_COUNT, aos / ITERATIONS, soa / ITERATIONS);
+	}
+
+	void BenchSoAChurn() {
+		constexpr size_t CHURN_COUNT = 100'000;
+
+		// A <- BodySoA <- B, so BodySoA is both a required and a sustained component
+		bseecs::ECS ecs;
+		ecs.RegisterComponent<A>();
+		ecs.RegisterComponent<BodySoA, A>();
+		ecs.RegisterComponent<B, BodySoA>();
+
+		double total = 0.0;
+		for (int i = 0; i < ITERATIONS; i++) {
+			total += MeasureMs([&]() {
+				std::vector<bseecs::EntityID> ids;
+				ids.reserve(CHURN_COUNT);
+				for (size_t j = 0; j < CHURN_COUNT; j++) {
+					bseecs::EntityID id = ecs.CreateEntity();
+					ecs.Add<A>(id);
+					ecs.Add<BodySoA, A>(id);
+					ecs.Add<B, BodySoA>(id);
+					ids.push_back(id);
+				}
+
+				for (bseecs::EntityID id : ids) {
+					ecs.Patch<BodySoA>(id, [](bseecs::SparseSet<BodySoA>::Reference body) {
+						body.Get<&BodySoA::x>() += body.Get<&BodySoA::vx>();
+					});
+					ecs.Remove<B>(id);
+					ecs.Remove<BodySoA, B>(id);
+					ecs.Remove<A, BodySoA>(id);
+					ecs.Add<A>(id);
+					ecs.Add<BodySoA, A>(id);
+				}
+
+				for (bseecs::EntityID& id : ids)
+					ecs.DeleteEntity(id);
+			});
+		}
+
+		std::printf("Add + Patch + Remove + DeleteEntity of %zu SoA components: %.3f ms/iter\n",
+			CHURN_COUNT, total / ITERATIONS);
+	}
+
+}
+
+int main() {
+	BenchForEachABC();
+	BenchForEachChunkABC();
+	BenchParallelForEachABC();
+	BenchHeapComponentChurn();
+	BenchIntegrateAoSvsSoA();
+	BenchSoAChurn();
+}
@@ -1,5 +1,5 @@
-#define SEECS_INFO_ENABLED
-#include "seecs.h"
+#define BSEECS_INFO_ENABLED
+#include "beecs.h"
 
 // Components hold data
 struct A {
@@ -17,17 +17,17 @@ struct C {
 int main() {
 	
 	// Base ECS instance, acts as a coordinator
-	seecs::ECS ecs;
+	bseecs::ECS ecs;
 
 	ecs.RegisterComponent<A>();
 	ecs.RegisterComponent<B>();
 	ecs.RegisterComponent<C>();
 
-	seecs::EntityID e1 = ecs.CreateEntity();
-	seecs::EntityID e2 = ecs.CreateEntity("e2"); // Custom name for debugging
-	seecs::EntityID e3 = ecs.CreateEntity();
-	seecs::EntityID e4 = ecs.CreateEntity();
-	seecs::EntityID e5 = ecs.CreateEntity();
+	bseecs::EntityID e1 = ecs.CreateEntity();
+	bseecs::EntityID e2 = ecs.CreateEntity("e2"); // Custom name for debugging
+	bseecs::EntityID e3 = ecs.CreateEntity();
+	bseecs::EntityID e4 = ecs.CreateEntity();
+	bseecs::EntityID e5 = ecs.CreateEntity();
 
 	ecs.Add<A>(e1, {5});  // Initialize component A(5)
 	ecs.Add<B>(e1); // Default constructor called
@@ -43,7 +43,7 @@ int main() {
 	ecs.Add<A>(e5);
 	ecs.Add<C>(e5);
 
-	ecs.ForEach<A, C>([&ecs](seecs::EntityID id, A& a, C& c) {
+	ecs.ForEach<A, C>([&ecs](bseecs::EntityID id, A& a, C& c) {
 		// ...
 	});
 
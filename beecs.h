@@ -12,6 +12,28 @@
 #include <memory>
 #include <type_traits>
 #include <cassert>
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <tuple>
+#include <optional>
+#include <functional>
+#include <numeric>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <new>
+#include <array>
+#include <iterator>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+	#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
 
 // Can replace these defines with custom macros elsewhere
 #ifndef BSEECS_ASSERTS
@@ -31,621 +53,4233 @@
 
 namespace bseecs {
 
-	// In ECS, entities are simply just indices which group data
+	// In ECS, entities are simply just indices which group data.
+	//
+	// The low 32 bits hold the index, the high 32 bits hold a generation
+	// that is bumped each time the index is recycled, so a handle kept
+	// around after DeleteEntity() can never alias the entity reusing its slot.
 	using EntityID = uint64_t;
+	using EntityIndex = uint32_t;
+	using EntityGeneration = uint32_t;
 
 	static constexpr EntityID NULL_ENTITY = std::numeric_limits<EntityID>::max();
 
 	// Max amount of entities alive at once.
-	// Set this to NULL_ENTITY if you want no limit.
+	// Can be raised up to 2^31, higher indices are reserved
+	// for entities pending creation in a CommandBuffer.
 	// Once limit is hit, an assert will fire and
 	// the program will terminate.
 	constexpr size_t MAX_ENTITIES = 1'000'000;
 
+	constexpr EntityIndex GetEntityIndex(EntityID id) {
+		return static_cast<EntityIndex>(id);
+	}
+
+	constexpr EntityGeneration GetEntityGeneration(EntityID id) {
+		return static_cast<EntityGeneration>(id >> 32);
+	}
+
+	constexpr EntityID MakeEntityID(EntityIndex index, EntityGeneration generation) {
+		return (static_cast<EntityID>(generation) << 32) | index;
+	}
+
 	// Should be a multiple of 32 (4 bytes), since
 	// bitset overallocates by 4 bytes each time.
 	constexpr size_t MAX_COMPONENTS = 64;
 
-	// Base class allows runtime polymorphism
-	class ISparseSet {
-	public:
-		virtual ~ISparseSet() = default;
-		virtual void Delete(EntityID) = 0;
-		virtual void Clear() = 0;
-	};
+	// 64 bit words per entity signature, see ECS::FindEntities()
+	constexpr size_t SIGNATURE_WORDS = (MAX_COMPONENTS + 63) / 64;
 
-	/*
-	*  A templated sparse set implementation, mapping EntityID -> T
-	* 
-	*  - Get(EntityID): returns T or NULL if EntityID is not in sparse set
-	*  - Set(EntityID, T&&): Adds/Overwrites into the dense list for the specified entity
-	*  - Delete(EntityID): Removes data for EntityID from dense list
-	*/
-	template <typename T>
-	class SparseSet: public ISparseSet {
-	private:
+	// Used to split the work of ParallelForEach() without false sharing
+	constexpr size_t CACHE_LINE_SIZE = 64;
 
-		using Sparse = std::vector<size_t>;
+	// ParallelForEach() aims for this many chunks per thread, for load
+	// balancing, but never makes chunks smaller than MIN_PARALLEL_CHUNK
+	constexpr size_t CHUNKS_PER_THREAD = 4;
+	constexpr size_t MIN_PARALLEL_CHUNK = 1024;
 
-		std::vector<Sparse> m_sparsePages;
+	// Each bit in the mask represents a component,
+	// '1' == active, '0' == inactive.
+	using ComponentMask = std::bitset<MAX_COMPONENTS>;
 
-		std::vector<T> m_dense;
-		std::vector<EntityID> m_denseToEntity; // 1:1 vector where dense index == Entity Index
+	// Change detection clock, see ECS::AdvanceTick()
+	using Tick = uint32_t;
 
-		const size_t SPARSE_MAX_SIZE = 1'000;
+	namespace internal {
 
-		static constexpr size_t tombstone = std::numeric_limits<size_t>::max();
+		// Hands out a new index every call, shared by all component types
+		inline size_t NextComponentTypeIndex() {
+			static std::atomic<size_t> counter{ 0 };
+			return counter++;
+		}
 
-		/*
-		* Inserts a given dense index into the sparse vector, associating
-		* an Entity ID with the index in the dense vector.
-		*
-		* This doesnt actually insert anything into the dense
-		* vector, it simply defines a mapping from ID -> index
-		*/
-		void SetDenseIndex(EntityID id, size_t index) {
-			size_t page = id / SPARSE_MAX_SIZE;
-			size_t sparseIndex = id % SPARSE_MAX_SIZE; // Index local to a page
+		// Same for event types, kept apart so events don't use up component slots
+		inline size_t NextEventTypeIndex() {
+			static std::atomic<size_t> counter{ 0 };
+			return counter++;
+		}
 
-			if (page >= m_sparsePages.size())
-				m_sparsePages.resize(page + 1);
+		// Identifies event channel instances, never reused
+		inline uint64_t NextEventChannelID() {
+			static std::atomic<uint64_t> counter{ 0 };
+			return counter++;
+		}
 
-			Sparse& sparse = m_sparsePages[page];
-			if (sparseIndex >= sparse.size())
-				sparse.resize(sparseIndex + 1, tombstone);
+		template <typename Member>
+		struct MemberTraits;
 
-			sparse[sparseIndex] = index;
+		template <typename Class, typename Field>
+		struct MemberTraits<Field Class::*> {
+			using ClassType = Class;
+			using FieldType = Field;
+		};
+
+		// Position of a member pointer among others, sizeof...(Members) if absent
+		template <auto Member, auto... Members>
+		constexpr size_t MemberIndex() {
+			constexpr bool matches[] = { std::is_same_v<
+				std::integral_constant<decltype(Member), Member>,
+				std::integral_constant<decltype(Members), Members>>... };
+
+			for (size_t i = 0; i < sizeof...(Members); i++) {
+				if (matches[i])
+					return i;
+			}
+			return sizeof...(Members);
+		}
+
+		// Exponent of a power of two
+		constexpr size_t Log2(size_t value) {
+			size_t shift = 0;
+			while ((size_t(1) << shift) < value)
+				shift++;
+			return shift;
+		}
+
+		inline size_t CountTrailingZeros(uint64_t value) {
+		#if defined(__GNUC__) || defined(__clang__)
+			return static_cast<size_t>(__builtin_ctzll(value));
+		#elif defined(_MSC_VER) && defined(_M_X64)
+			unsigned long index;
+			_BitScanForward64(&index, value);
+			return index;
+		#else
+			size_t count = 0;
+			for (; !(value & 1); value >>= 1)
+				count++;
+			return count;
+		#endif
 		}
 
 		/*
-		* Returns the dense index for a given entity ID,
-		* or a tombstone (null) value if non-existent
+		*  Appends the index of every signature s with (s & include) == include
+		*  and (s & exclude) == 0. Signatures are Words words each.
 		*/
-		size_t GetDenseIndex(EntityID id) {
-			size_t page = id / SPARSE_MAX_SIZE;
-			size_t sparseIndex = id % SPARSE_MAX_SIZE;
-
-			if (page < m_sparsePages.size()) {
-				Sparse& sparse = m_sparsePages[page];
-				if (sparseIndex < sparse.size())
-					return sparse[sparseIndex];
+		template <size_t Words>
+		void FilterSignatures(const uint64_t* signatures, size_t count,
+			const uint64_t* include, const uint64_t* exclude, std::vector<EntityID>& out)
+		{
+			size_t i = 0;
+
+			if constexpr (Words == 1) {
+			#if defined(__AVX2__)
+				const __m256i inc = _mm256_set1_epi64x(static_cast<long long>(include[0]));
+				const __m256i exc = _mm256_set1_epi64x(static_cast<long long>(exclude[0]));
+				const __m256i zero = _mm256_setzero_si256();
+				for (; i + 4 <= count; i += 4) {
+					__m256i sig = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(signatures + i));
+					__m256i hasAll = _mm256_cmpeq_epi64(_mm256_and_si256(sig, inc), inc);
+					__m256i hasNone = _mm256_cmpeq_epi64(_mm256_and_si256(sig, exc), zero);
+					int matches = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_and_si256(hasAll, hasNone)));
+					for (; matches != 0; matches &= matches - 1)
+						out.push_back(i + CountTrailingZeros(static_cast<uint64_t>(matches)));
+				}
+			#elif defined(__SSE4_1__)
+				const __m128i inc = _mm_set1_epi64x(static_cast<long long>(include[0]));
+				const __m128i exc = _mm_set1_epi64x(static_cast<long long>(exclude[0]));
+				const __m128i zero = _mm_setzero_si128();
+				for (; i + 2 <= count; i += 2) {
+					__m128i sig = _mm_loadu_si128(reinterpret_cast<const __m128i*>(signatures + i));
+					__m128i hasAll = _mm_cmpeq_epi64(_mm_and_si128(sig, inc), inc);
+					__m128i hasNone = _mm_cmpeq_epi64(_mm_and_si128(sig, exc), zero);
+					int matches = _mm_movemask_pd(_mm_castsi128_pd(_mm_and_si128(hasAll, hasNone)));
+					for (; matches != 0; matches &= matches - 1)
+						out.push_back(i + CountTrailingZeros(static_cast<uint64_t>(matches)));
+				}
+			#endif
 			}
 
-			return tombstone;
+			// Remainder, or every entity when no SIMD path applies
+			for (; i < count; i++) {
+				const uint64_t* signature = signatures + i * Words;
+				bool matches = true;
+				for (size_t word = 0; word < Words && matches; word++)
+					matches = (signature[word] & include[word]) == include[word] && (signature[word] & exclude[word]) == 0;
+
+				if (matches)
+					out.push_back(i);
+			}
 		}
 
-	public:
+		template <typename Func, typename ArgsTuple>
+		struct IsInvocableWithTuple;
 
-		SparseSet() {
-			// Avoids initial copies/allocation, feel free to alter size
-			m_dense.reserve(100);
+		template <typename Func, typename... Args>
+		struct IsInvocableWithTuple<Func, std::tuple<Args...>> : std::is_invocable<Func, Args...> {};
+
+		// Arguments handed to ForEach() lambdas for a component, tags can be omitted
+		template <typename T>
+		using NonTagArgs = std::conditional_t<std::is_empty_v<std::remove_const_t<T>>, std::tuple<>, std::tuple<T&>>;
+
+		template <typename T>
+		NonTagArgs<T> AsNonTagArgs(T& component) {
+			if constexpr (std::is_empty_v<std::remove_const_t<T>>)
+				return {};
+			else
+				return NonTagArgs<T>(component);
 		}
 
-		T* Set(EntityID id, T obj) {
-			// If index already exists, then simply overwrite
-			// that element in dense list, no need to delete
-			size_t index = GetDenseIndex(id);
-			if (index != tombstone) {
-				m_dense[index] = obj;
-				m_denseToEntity[index] = id;
+		/*
+		*  Calls a ForEach() style lambda for one entity, in whichever form it accepts:
+		*  [](EntityID id, Component& c1, ...), [](Component& c1, ...),
+		*  or the same two with tag components left out.
+		*/
+		template <typename Func, typename... Components>
+		void InvokeEach(Func& func, EntityID id, Components&... components) {
+			if constexpr (std::is_invocable_v<Func, EntityID, Components&...>)
+			{
+				func(id, components...);
+			}
 
-				return &m_dense[index];
+			else if constexpr (std::is_invocable_v<Func, Components&...>)
+			{
+				func(components...);
 			}
 
-			// New index will be the back of the dense list
-			SetDenseIndex(id, m_dense.size());
+			else if constexpr (IsInvocableWithTuple<Func, decltype(std::tuple_cat(std::tuple<EntityID>(), std::declval<NonTagArgs<Components>>()...))>::value)
+			{
+				std::apply(func, std::tuple_cat(std::tuple<EntityID>(id), AsNonTagArgs(components)...));
+			}
 
-			m_dense.push_back(obj);
-			m_denseToEntity.push_back(id);
+			else if constexpr (IsInvocableWithTuple<Func, decltype(std::tuple_cat(std::declval<NonTagArgs<Components>>()...))>::value)
+			{
+				std::apply(func, std::tuple_cat(AsNonTagArgs(components)...));
+			}
 
-			return &m_dense.back();
+			else
+			{
+				BSEECS_ASSERT(false,
+					"Bad lambda provided to .Each(), parameter pack does not match lambda args");
+			}
 		}
 
-		T* Get(EntityID id) {
-			size_t index = GetDenseIndex(id);
-			return (index != tombstone) ? &m_dense[index] : nullptr;
-		}
+	}
 
-		T& GetRef(EntityID id)
-		{
-			size_t index = GetDenseIndex(id);
-			return m_dense[index];
-			//return (index != tombstone) ? m_dense[index] : nullptr;
-		}
+	/*
+	*  Returns a per-type index, assigned the first time a component type
+	*  is seen and stable for the rest of the process.
+	* 
+	*  Used directly as the bit position in ComponentMask and as the slot
+	*  in ECS::m_componentPools, so pool lookups are a plain array load.
+	*/
+	template <typename T>
+	size_t ComponentTypeIndex() {
+		static const size_t index = internal::NextComponentTypeIndex();
+		return index;
+	}
 
+	// Per-type index of event types, slot in ECS::m_eventChannels
+	template <typename T>
+	size_t EventTypeIndex() {
+		static const size_t index = internal::NextEventTypeIndex();
+		return index;
+	}
 
-		EntityID GetEntity(EntityID compId)
+	/*
+	*  Non-owning view over a contiguous array, stands in for std::span
+	*  which needs C++20. Built from a pointer and a size, or implicitly
+	*  from any container with data() and size() (std::vector, std::array).
+	*/
+	template <typename T>
+	class Span {
+	private:
+		T* m_data = nullptr;
+		size_t m_size = 0;
+
+	public:
+		Span() = default;
+
+		Span(T* data, size_t size)
+			: m_data(data), m_size(size)
 		{
-			return m_denseToEntity[compId];
 		}
-		
-		void Delete(EntityID id) override {
 
-			size_t deletedIndex = GetDenseIndex(id);
-			BSEECS_ASSERT(deletedIndex != tombstone && !m_dense.empty(), "Trying to delete non-existent entity in sparse set");
+		template <typename Container, typename = std::enable_if_t<
+			std::is_convertible_v<decltype(std::declval<Container&>().data()), T*>>>
+		Span(Container& container)
+			: m_data(container.data()), m_size(container.size())
+		{
+		}
 
-			SetDenseIndex(m_denseToEntity.back(), deletedIndex);
-			SetDenseIndex(id, tombstone);
+		// Span<T> to Span<const T>
+		template <typename U, typename = std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>>>
+		Span(const Span<U>& other)
+			: m_data(other.data()), m_size(other.size())
+		{
+		}
 
-			std::swap(m_dense.back(), m_dense[deletedIndex]);
-			std::swap(m_denseToEntity.back(), m_denseToEntity[deletedIndex]);
+		T* data() const {
+			return m_data;
+		}
 
-			m_dense.pop_back();
-			m_denseToEntity.pop_back();
+		size_t size() const {
+			return m_size;
 		}
 
-		void Clear() override {
-			m_dense.clear();
-			m_sparsePages.clear();
-			m_denseToEntity.clear();
+		bool empty() const {
+			return m_size == 0;
 		}
 
-		bool IsEmpty() const {
-			return m_dense.empty();
+		T& operator[](size_t index) const {
+			return m_data[index];
 		}
 
-		// Dense list
-		std::vector<T>& Data()
-		{
-			return m_dense;
+		T* begin() const {
+			return m_data;
 		}
 
-		void PrintDense() {
-			std::stringstream ss;
-			std::string delim = "";
-			for (const T& e : m_dense) {
-				ss << delim << e;
-				if (delim.empty())
-					delim = ", ";
-			}
-			BSEECS_INFO("[" << ss.str() << "]");
+		T* end() const {
+			return m_data + m_size;
 		}
+	};
+
+	class ISparseSet;
+
+	/*
+	*  Notified by a sparse set every time the position of an entity in
+	*  its dense list changes, see SiblingLinks.
+	*/
+	class IDenseIndexListener {
+	public:
+		virtual ~IDenseIndexListener() = default;
 
+		// The element of the entity is now at 'index' of the dense list
+		virtual void OnDenseIndexSet(const ISparseSet& pool, EntityID id, size_t index) = 0;
+
+		// The entity was removed from the set
+		virtual void OnDenseIndexCleared(const ISparseSet& pool, EntityID id) = 0;
 	};
 
+	// Base class allows runtime polymorphism
+	class ISparseSet {
+	protected:
+		// Usually empty, checked before any notification
+		std::vector<IDenseIndexListener*> m_denseIndexListeners;
 
-	class ECS {
-	private:
+	public:
+		virtual ~ISparseSet() = default;
+		virtual void Delete(EntityID) = 0;
+		// Removes several entities at once, all of them must be in the set
+		virtual void DeleteBulk(Span<const EntityID> ids) = 0;
+		virtual void Clear() = 0;
 
-		// Each bit in the mask represents a component,
-		// '1' == active, '0' == inactive.
-		using ComponentMask = std::bitset<MAX_COMPONENTS>;
+		void AddDenseIndexListener(IDenseIndexListener* listener) {
+			m_denseIndexListeners.push_back(listener);
+		}
+	};
 
+	/*
+	*  Notified by the ECS whenever a component of the type it is
+	*  registered to is attached to or detached from an entity.
+	*/
+	class IComponentListener {
+	public:
+		virtual ~IComponentListener() = default;
 
-		using TypeName = const char*;
+		// Called after the component is added
+		virtual void OnAdd(EntityID id) = 0;
 
+		// Called before the component is removed, while it can still be accessed
+		virtual void OnRemove(EntityID id) = 0;
 
-		// List of IDs already created, but no longer in use
-		std::vector<EntityID> m_availableEntities;
+		// Called by ECS::Clear() instead of OnRemove() for every entity,
+		// once all pools have been emptied
+		virtual void OnClear() {}
 
+		// Called by ECS::Patch() and ECS::MarkChanged()
+		virtual void OnUpdate(EntityID) {}
+	};
 
-		// Associates ID with name provided in CreateEntity(), mainly for debugging
-		std::unordered_map<EntityID, std::string> m_entityNames;
+	/*
+	*  Callbacks run on every construction, destruction or update of a
+	*  component type, see ECS::OnConstruct(), OnDestroy() and OnUpdate().
+	*/
+	class ComponentSignals : public IComponentListener {
+	public:
 
+		using Callback = std::function<void(EntityID)>;
 
-		// Holds generic pointers to specific component sparse sets.
-		// 
-		// Index into this array using the corresponding bit position
-		// found by using m_componentBitPosition
-		std::vector<std::unique_ptr<ISparseSet>> m_componentPools;
+	private:
 
-		struct ComponentInfo
-		{
-			size_t m_bitPosition{};
-			ComponentMask m_requiredComponents{};
-			ComponentMask m_isRequiredInComponents{};
-		};
+		// Deques so a callback connecting another one keeps its own
+		// address, dispatch goes by index over the callbacks present
+		// when it starts
+		std::deque<Callback> m_onConstruct;
+		std::deque<Callback> m_onDestroy;
+		std::deque<Callback> m_onUpdate;
 
-		// Key is component name, value is the bit position in ComponentMask
-		std::unordered_map<TypeName, ComponentInfo> m_componentBitPosition;
+		static void Dispatch(std::deque<Callback>& callbacks, EntityID id) {
+			for (size_t i = 0, count = callbacks.size(); i < count; i++)
+				callbacks[i](id);
+		}
 
+	public:
 
-		// Highest recorded entity ID
-		EntityID m_maxEntityID = 0;
+		void ConnectConstruct(Callback callback) {
+			m_onConstruct.push_back(std::move(callback));
+		}
 
+		void ConnectDestroy(Callback callback) {
+			m_onDestroy.push_back(std::move(callback));
+		}
 
-		static constexpr size_t tombstone = std::numeric_limits<size_t>::max();
+		void ConnectUpdate(Callback callback) {
+			m_onUpdate.push_back(std::move(callback));
+		}
 
+		void OnAdd(EntityID id) override {
+			Dispatch(m_onConstruct, id);
+		}
 
-		#define ENTITY_INFO(id) \
-			"['" << GetEntityName(id) << "', ID: " << id << "]"
+		void OnRemove(EntityID id) override {
+			Dispatch(m_onDestroy, id);
+		}
 
-		#define BSEECS_ASSERT_VALID_ENTITY(id) \
-			BSEECS_ASSERT(id != NULL_ENTITY, "NULL_ENTITY cannot be operated on by the ECS") \
-			BSEECS_ASSERT(id < m_maxEntityID && id >= 0, "Invalid entity ID out of bounds: " << id);
+		void OnUpdate(EntityID id) override {
+			Dispatch(m_onUpdate, id);
+		}
+	};
 
-	
+	/*
+	*  Accumulates the entities whose component of a type was added,
+	*  removed or updated, see ECS::Observe(). Meant to be processed in
+	*  bulk, e.g. once per frame, then cleared.
+	* 
+	*  An entity appears once per event, so it can be listed in several
+	*  arrays or several times in one.
+	*/
+	class ComponentEvents : public IComponentListener {
 	private:
 
-		template <typename T>
-		size_t GetComponentBitPosition() {
-			TypeName name = typeid(T).name();
-			auto it = m_componentBitPosition.find(name);
-			if (it == m_componentBitPosition.end())
-				return tombstone;
+		std::vector<EntityID> m_added;
+		std::vector<EntityID> m_removed;
+		std::vector<EntityID> m_updated;
 
-			return it->second.m_bitPosition;
-		}
+		bool m_cleared = false;
 
-		template <typename T>
-		ComponentMask* const GetRequiredComponent()
-		{
-			TypeName name = typeid(T).name();
-			auto it = m_componentBitPosition.find(name);
-			if (it == m_componentBitPosition.end())
-				return nullptr;
+	public:
 
-			return &it->second.m_requiredComponents;
+		void OnAdd(EntityID id) override {
+			m_added.push_back(id);
 		}
 
-		template <typename T>
-		ComponentMask* const GetSustainedComponent()
-		{
-			TypeName name = typeid(T).name();
-			auto it = m_componentBitPosition.find(name);
-			if (it == m_componentBitPosition.end())
-				return nullptr;
+		void OnRemove(EntityID id) override {
+			m_removed.push_back(id);
+		}
 
-			return &it->second.m_isRequiredInComponents;
+		void OnUpdate(EntityID id) override {
+			m_updated.push_back(id);
 		}
 
+		void OnClear() override {
+			m_cleared = true;
+		}
 
-		template <typename Component>
-		void SetComponentBit(ComponentMask& mask, bool val) {
-			size_t bitPos = GetComponentBitPosition<Component>();
-			BSEECS_ASSERT(bitPos != tombstone,
-				"Attempting to operate on unregistered component '" << typeid(Component).name() << "'");
+		const std::vector<EntityID>& Added() const {
+			return m_added;
+		}
 
-			mask[bitPos] = val;
+		const std::vector<EntityID>& Removed() const {
+			return m_removed;
 		}
 
-		template <typename Component>
-		ComponentMask::reference GetComponentBit(ComponentMask& mask) {
-			size_t bitPos = GetComponentBitPosition<Component>();
-			BSEECS_ASSERT(bitPos != tombstone,
-				"Attempting to operate on unregistered component '" << typeid(Component).name() << "'");
+		const std::vector<EntityID>& Updated() const {
+			return m_updated;
+		}
 
-			return mask[bitPos];
+		// True if ECS::Clear() ran since the last Clear(), the entities
+		// it removed are not listed in Removed()
+		bool WasCleared() const {
+			return m_cleared;
 		}
 
-		/*
-		*  Assembles a generic mask for the given components
-		*/
-		template <typename... Components>
-		ComponentMask GetMask() {
-			ComponentMask mask;
-			(SetComponentBit<Components>(mask, 1), ...); // fold expression
-			return mask;
+		bool IsEmpty() const {
+			return m_added.empty() && m_removed.empty() && m_updated.empty() && !m_cleared;
 		}
 
-		template <typename DependentComponent, typename RequiredComponent>
-		void SetRequirements()
-		{
-			TypeName name = typeid(RequiredComponent).name();
-			ComponentMask& requiredCompMask = m_componentBitPosition.find(name)->second.m_isRequiredInComponents;
-			SetComponentBit<DependentComponent>(requiredCompMask, 1);
+		// Empties the arrays, keeping their capacity
+		void Clear() {
+			m_added.clear();
+			m_removed.clear();
+			m_updated.clear();
+			m_cleared = false;
 		}
+	};
 
-		/*
-		*  Broadcast to the components that I depends on, the requirement
-		* To make it easy when removing it
-		*/
-		template <typename DependentComponent, typename... RequiredComponents>
-		void BroadcastRequirements()
-		{
-			// Get the bit position of the component
-			(SetRequirements<DependentComponent, RequiredComponents>(), ...); // fold expression
+	/*
+	*  Dense storage made of fixed size pages, with the same interface as
+	*  the std::vector used by default.
+	* 
+	*  Elements never move when the storage grows, so growing costs a
+	*  single page allocation instead of a full copy. Elements are
+	*  contiguous within a page.
+	* 
+	*  The pool still moves elements around within the storage, so a
+	*  reference or pointer may end up on another entity's component after:
+	*  - removing any entity of the pool, the last element moves into the hole
+	*  - an owning group packing its entities with SwapDense()
+	*  - Sort() or SortAs() on the pool
+	*/
+	template <typename T, size_t PageSize = 1024>
+	class PagedStorage {
+	private:
+
+		static_assert(PageSize > 0 && (PageSize & (PageSize - 1)) == 0, "PageSize must be a power of two");
+
+		static constexpr size_t PAGE_SHIFT = internal::Log2(PageSize);
+		static constexpr size_t PAGE_MASK = PageSize - 1;
+		static constexpr std::align_val_t PAGE_ALIGNMENT{ std::max(alignof(T), CACHE_LINE_SIZE) };
+
+		// Raw memory, elements are constructed in place
+		std::vector<T*> m_pages;
+		size_t m_size = 0;
+
+
+		void AddPage() {
+			void* memory = ::operator new(sizeof(T) * PageSize, PAGE_ALIGNMENT);
+			m_pages.push_back(static_cast<T*>(memory));
 		}
 
 	public:
 
-		ECS() = default;
+		using value_type = T;
 
-		/*
-		* Retrieves reference for the specific component pool given a component name
-		*/
-		template <typename T>
-		SparseSet<T>& GetComponentPool(bool registerIfNotFound = false)
-		{
-			size_t bitPos = GetComponentBitPosition<T>();
+		static constexpr size_t ElementsPerPage = PageSize;
 
-			if (bitPos == tombstone)
-			{
+		PagedStorage() = default;
+
+		PagedStorage(const PagedStorage&) = delete;
+		PagedStorage& operator=(const PagedStorage&) = delete;
+
+		~PagedStorage() {
+			clear();
+			for (T* page : m_pages)
+				::operator delete(page, PAGE_ALIGNMENT);
+		}
+
+		size_t size() const {
+			return m_size;
+		}
+
+		bool empty() const {
+			return m_size == 0;
+		}
+
+		T& operator[](size_t index) {
+			return m_pages[index >> PAGE_SHIFT][index & PAGE_MASK];
+		}
+
+		const T& operator[](size_t index) const {
+			return m_pages[index >> PAGE_SHIFT][index & PAGE_MASK];
+		}
+
+		T& back() {
+			return (*this)[m_size - 1];
+		}
+
+		template <typename... Args>
+		T& emplace_back(Args&&... args) {
+			if ((m_size >> PAGE_SHIFT) >= m_pages.size())
+				AddPage();
+
+			T* element = new (&m_pages[m_size >> PAGE_SHIFT][m_size & PAGE_MASK]) T(std::forward<Args>(args)...);
+			m_size++;
+			return *element;
+		}
+
+		void push_back(const T& value) {
+			emplace_back(value);
+		}
+
+		void push_back(T&& value) {
+			emplace_back(std::move(value));
+		}
+
+		void pop_back() {
+			back().~T();
+			m_size--;
+		}
+
+		// Allocates pages up front, existing elements stay in place
+		void reserve(size_t capacity) {
+			while (m_pages.size() * PageSize < capacity)
+				AddPage();
+		}
+
+		// Destroys every element, keeping the pages for reuse
+		void clear() {
+			while (m_size > 0)
+				pop_back();
+		}
+
+		size_t PageCount() const {
+			return (m_size + PAGE_MASK) >> PAGE_SHIFT;
+		}
+
+		// Contiguous elements of a page, PageElementCount(page) of them
+		T* PageData(size_t page) {
+			return m_pages[page];
+		}
+
+		size_t PageElementCount(size_t page) const {
+			return std::min(PageSize, m_size - page * PageSize);
+		}
+	};
+
+	/*
+	*  Dense storage of tag components (empty types, e.g. struct Enemy {}).
+	* 
+	*  Only counts elements, every element is the same shared instance,
+	*  so the pool only pays for its entity list and sparse pages.
+	*/
+	template <typename T>
+	class EmptyStorage {
+	private:
+
+		static_assert(std::is_empty_v<T>, "EmptyStorage only holds empty types");
+
+		static inline T s_instance{};
+
+		size_t m_size = 0;
+
+	public:
+
+		using value_type = T;
+
+		size_t size() const {
+			return m_size;
+		}
+
+		bool empty() const {
+			return m_size == 0;
+		}
+
+		T& operator[](size_t) {
+			return s_instance;
+		}
+
+		const T& operator[](size_t) const {
+			return s_instance;
+		}
+
+		T& back() {
+			return s_instance;
+		}
+
+		template <typename... Args>
+		T& emplace_back(Args&&...) {
+			m_size++;
+			return s_instance;
+		}
+
+		void push_back(const T&) {
+			m_size++;
+		}
+
+		void pop_back() {
+			m_size--;
+		}
+
+		void reserve(size_t) {}
+
+		void clear() {
+			m_size = 0;
+		}
+	};
+
+	/*
+	*  Structure of arrays dense storage: each listed member of T lives in
+	*  its own cache line aligned array, so loops over a few fields only
+	*  stream those fields, and can be vectorized by the compiler.
+	* 
+	*  template <>
+	*  struct ComponentTraits<Particle> : DefaultComponentTraits<Particle> {
+	*      using Storage = SoAStorage<Particle, &Particle::position, &Particle::velocity>;
+	*  };
+	* 
+	*  Every data member of T must be listed, others are lost. Elements
+	*  have no address: operator[] returns a Reference proxy converting
+	*  to and assignable from T, with Get<&T::member>() for a single field.
+	*  Use ECS::ForEachFields() to iterate, View() and ForEach() need
+	*  addressable components.
+	*/
+	template <typename T, auto... Members>
+	class SoAStorage {
+	private:
+
+		static_assert(sizeof...(Members) > 0, "SoAStorage needs at least one member");
+		static_assert((std::is_same_v<typename internal::MemberTraits<decltype(Members)>::ClassType, T> && ...),
+			"SoAStorage members must be data members of T");
+
+		template <size_t I>
+		using FieldType = typename internal::MemberTraits<std::tuple_element_t<I, std::tuple<decltype(Members)...>>>::FieldType;
+
+		template <auto Member>
+		using MemberType = typename internal::MemberTraits<decltype(Member)>::FieldType;
+
+		static constexpr std::tuple<decltype(Members)...> MEMBERS{ Members... };
+
+		std::tuple<typename internal::MemberTraits<decltype(Members)>::FieldType*...> m_fields{};
+		size_t m_size = 0;
+		size_t m_capacity = 0;
+
+
+		template <typename F>
+		static constexpr std::align_val_t FieldAlignment() {
+			return std::align_val_t{ std::max(alignof(F), CACHE_LINE_SIZE) };
+		}
+
+		// Calls func(std::integral_constant<size_t, I>) for every field
+		template <typename Func>
+		static void ForEachField(Func&& func) {
+			ForEachFieldImpl(func, std::index_sequence_for<decltype(Members)...>{});
+		}
+
+		template <typename Func, size_t... I>
+		static void ForEachFieldImpl(Func& func, std::index_sequence<I...>) {
+			(func(std::integral_constant<size_t, I>{}), ...);
+		}
+
+		void Grow(size_t capacity) {
+			ForEachField([&](auto field) {
+				using F = FieldType<decltype(field)::value>;
+				F*& data = std::get<decltype(field)::value>(m_fields);
+
+				F* grown = static_cast<F*>(::operator new(sizeof(F) * capacity, FieldAlignment<F>()));
+				for (size_t i = 0; i < m_size; i++) {
+					new (&grown[i]) F(std::move(data[i]));
+					data[i].~F();
+				}
+
+				if (data)
+					::operator delete(data, FieldAlignment<F>());
+				data = grown;
+			});
+			m_capacity = capacity;
+		}
+
+		T Gather(size_t index) const {
+			T value{};
+			ForEachField([&](auto field) {
+				value.*std::get<decltype(field)::value>(MEMBERS) = std::get<decltype(field)::value>(m_fields)[index];
+			});
+			return value;
+		}
+
+	public:
+
+		using value_type = T;
+
+		// Stands in for T& to an element
+		class Reference {
+		private:
+			SoAStorage* m_storage;
+			size_t m_index;
+
+		public:
+			Reference(SoAStorage* storage, size_t index)
+				: m_storage(storage), m_index(index)
+			{
+			}
+
+			// Copies refer to the same element
+			Reference(const Reference&) = default;
+
+			template <auto Member>
+			MemberType<Member>& Get() const {
+				return m_storage->template FieldData<Member>()[m_index];
+			}
+
+			operator T() const {
+				return m_storage->Gather(m_index);
+			}
+
+			// Assignments write through to the element, like T& would
+			Reference& operator=(const T& value) {
+				ForEachField([&](auto field) {
+					std::get<decltype(field)::value>(m_storage->m_fields)[m_index] = value.*std::get<decltype(field)::value>(MEMBERS);
+				});
+				return *this;
+			}
+
+			Reference& operator=(T&& value) {
+				ForEachField([&](auto field) {
+					std::get<decltype(field)::value>(m_storage->m_fields)[m_index] = std::move(value.*std::get<decltype(field)::value>(MEMBERS));
+				});
+				return *this;
+			}
+
+			Reference& operator=(const Reference& other) {
+				ForEachField([&](auto field) {
+					std::get<decltype(field)::value>(m_storage->m_fields)[m_index] = std::get<decltype(field)::value>(other.m_storage->m_fields)[other.m_index];
+				});
+				return *this;
+			}
+
+			Reference& operator=(Reference&& other) {
+				ForEachField([&](auto field) {
+					std::get<decltype(field)::value>(m_storage->m_fields)[m_index] = std::move(std::get<decltype(field)::value>(other.m_storage->m_fields)[other.m_index]);
+				});
+				return *this;
+			}
+
+			// Swaps the elements, not the references
+			void Swap(Reference other) {
+				ForEachField([&](auto field) {
+					using std::swap;
+					swap(std::get<decltype(field)::value>(m_storage->m_fields)[m_index],
+						std::get<decltype(field)::value>(other.m_storage->m_fields)[other.m_index]);
+				});
+			}
+
+			friend void swap(Reference lhs, Reference rhs) {
+				lhs.Swap(rhs);
+			}
+		};
+
+		SoAStorage() = default;
+
+		SoAStorage(const SoAStorage&) = delete;
+		SoAStorage& operator=(const SoAStorage&) = delete;
+
+		~SoAStorage() {
+			clear();
+			ForEachField([&](auto field) {
+				using F = FieldType<decltype(field)::value>;
+				if (F* data = std::get<decltype(field)::value>(m_fields))
+					::operator delete(data, FieldAlignment<F>());
+			});
+		}
+
+		size_t size() const {
+			return m_size;
+		}
+
+		bool empty() const {
+			return m_size == 0;
+		}
+
+		Reference operator[](size_t index) {
+			return Reference(this, index);
+		}
+
+		T operator[](size_t index) const {
+			return Gather(index);
+		}
+
+		Reference back() {
+			return Reference(this, m_size - 1);
+		}
+
+		template <typename... Args>
+		Reference emplace_back(Args&&... args) {
+			T value = [&]() {
+				if constexpr (std::is_constructible_v<T, Args...>)
+					return T(std::forward<Args>(args)...);
+				else
+					return T{ std::forward<Args>(args)... };
+			}();
+
+			if (m_size == m_capacity)
+				Grow(std::max<size_t>(16, m_capacity * 2));
+
+			ForEachField([&](auto field) {
+				using F = FieldType<decltype(field)::value>;
+				new (&std::get<decltype(field)::value>(m_fields)[m_size]) F(std::move(value.*std::get<decltype(field)::value>(MEMBERS)));
+			});
+
+			m_size++;
+			return back();
+		}
+
+		void push_back(const T& value) {
+			emplace_back(value);
+		}
+
+		void push_back(T&& value) {
+			emplace_back(std::move(value));
+		}
+
+		void pop_back() {
+			m_size--;
+			ForEachField([&](auto field) {
+				using F = FieldType<decltype(field)::value>;
+				std::get<decltype(field)::value>(m_fields)[m_size].~F();
+			});
+		}
+
+		void reserve(size_t capacity) {
+			if (capacity > m_capacity)
+				Grow(capacity);
+		}
+
+		void clear() {
+			while (m_size > 0)
+				pop_back();
+		}
+
+		// Contiguous array of one member, size() elements long
+		template <auto Member>
+		MemberType<Member>* FieldData() {
+			constexpr size_t index = internal::MemberIndex<Member, Members...>();
+			static_assert(index < sizeof...(Members), "Member is not stored by this SoAStorage");
+			return std::get<index>(m_fields);
+		}
+
+		template <auto Member>
+		Span<MemberType<Member>> Field() {
+			return Span<MemberType<Member>>(FieldData<Member>(), m_size);
+		}
+	};
+
+	namespace internal {
+
+		// End of the contiguous run of elements starting at 'begin', at most 'end'
+		template <typename T, typename Allocator>
+		size_t ContiguousEnd(const std::vector<T, Allocator>&, size_t, size_t end) {
+			return end;
+		}
+
+		template <typename T, size_t PageSize>
+		size_t ContiguousEnd(const PagedStorage<T, PageSize>&, size_t begin, size_t end) {
+			return std::min(end, (begin / PageSize + 1) * PageSize);
+		}
+
+	}
+
+	/*
+	*  Per component customization point of the pool storage.
+	*  Specialize ComponentTraits for a component to change it, e.g.
+	* 
+	*  template <>
+	*  struct ComponentTraits<Transform> : DefaultComponentTraits<Transform> {
+	*      using Storage = PagedStorage<Transform>;
+	*  };
+	*/
+	template <typename T>
+	struct DefaultComponentTraits {
+		// Dense list, std::vector<T>, PagedStorage<T, N> for addresses stable across growth
+		// or SoAStorage<T, &T::members...> for one array per member.
+		// Tag components only keep a count.
+		using Storage = std::conditional_t<std::is_empty_v<T>, EmptyStorage<T>, std::vector<T>>;
+
+		// Type of the dense indices stored in the sparse pages, must be
+		// able to hold the max pool size plus one (reserved for tombstones)
+		using DenseIndex = uint32_t;
+
+		// Entity indices per sparse page, must be a power of two
+		static constexpr size_t SparsePageSize = 4096;
+
+		// Also keep one presence bit per entity index, making Contains()
+		// a single bit test and letting views intersect the bits of their
+		// required pools 64 entities at a time. Costs one bit per entity
+		// index up to the highest one in the pool. On for tag components,
+		// whose joins then become bitset intersections.
+		static constexpr bool PresenceBits = std::is_empty_v<T>;
+
+		// Also keep the tick at which each element was added and last
+		// changed, for the Added<T> and Changed<T> query terms
+		static constexpr bool TrackChanges = false;
+	};
+
+	template <typename T>
+	struct ComponentTraits : DefaultComponentTraits<T> {};
+
+	/*
+	*  A templated sparse set implementation, mapping EntityID -> T
+	*  The sparse pages are keyed by the entity index only, the full ID
+	*  (with generation) is kept in the dense to entity list.
+	* 
+	*  - Get(EntityID): returns T or NULL if EntityID is not in sparse set
+	*  - Set(EntityID, T&&): Adds/Overwrites into the dense list for the specified entity
+	*  - Emplace(EntityID, Args...): Same as Set(), constructing the element in place
+	*  - Delete(EntityID): Removes data for EntityID from dense list
+	* 
+	*  The dense list container is picked by Traits::Storage.
+	*/
+	template <typename T, typename Traits = ComponentTraits<T>>
+	class SparseSet: public ISparseSet {
+	public:
+
+		using Storage = typename Traits::Storage;
+
+		using DenseIndex = typename Traits::DenseIndex;
+
+		// T& unless the storage hands out proxies (SoAStorage)
+		using Reference = decltype(std::declval<Storage&>()[0]);
+
+		// Dense index of entities not in the set
+		static constexpr DenseIndex tombstone = std::numeric_limits<DenseIndex>::max();
+
+	private:
+
+		static constexpr size_t SPARSE_PAGE_SIZE = Traits::SparsePageSize;
+		static_assert(SPARSE_PAGE_SIZE > 0 && (SPARSE_PAGE_SIZE & (SPARSE_PAGE_SIZE - 1)) == 0,
+			"SparsePageSize must be a power of two");
+
+		static constexpr size_t SPARSE_PAGE_SHIFT = internal::Log2(SPARSE_PAGE_SIZE);
+		static constexpr size_t SPARSE_PAGE_MASK = SPARSE_PAGE_SIZE - 1;
+
+		// Pages are allocated whole and filled with tombstones,
+		// pages no entity in the set maps to are left null
+		using Sparse = std::unique_ptr<DenseIndex[]>;
+
+		std::vector<Sparse> m_sparsePages;
+
+		// Bit per entity index, only maintained with Traits::PresenceBits
+		std::vector<uint64_t> m_presence;
+
+		Storage m_dense;
+		std::vector<EntityID> m_denseToEntity; // 1:1 vector where dense index == Entity Index
+
+		// Parallel to the dense list, only maintained with Traits::TrackChanges
+		std::vector<Tick> m_addedTicks;
+		std::vector<Tick> m_changedTicks;
+
+		// Clock stamped into the ticks, owned by the ECS
+		const std::atomic<Tick>* m_tickSource = nullptr;
+
+		Tick CurrentTick() const {
+			return m_tickSource ? m_tickSource->load(std::memory_order_relaxed) : 0;
+		}
+
+		/*
+		* Inserts a given dense index into the sparse vector, associating
+		* an Entity ID with the index in the dense vector.
+		*
+		* This doesnt actually insert anything into the dense
+		* vector, it simply defines a mapping from ID -> index
+		*/
+		void SetDenseIndex(EntityID id, DenseIndex index) {
+			EntityIndex entityIndex = GetEntityIndex(id);
+			size_t page = entityIndex >> SPARSE_PAGE_SHIFT;
+			size_t sparseIndex = entityIndex & SPARSE_PAGE_MASK; // Index local to a page
+
+			if (page >= m_sparsePages.size())
+				m_sparsePages.resize(page + 1);
+
+			Sparse& sparse = m_sparsePages[page];
+			if (!sparse) {
+				sparse.reset(new DenseIndex[SPARSE_PAGE_SIZE]);
+				std::fill_n(sparse.get(), SPARSE_PAGE_SIZE, tombstone);
+			}
+
+			sparse[sparseIndex] = index;
+
+			if constexpr (Traits::PresenceBits) {
+				size_t word = entityIndex / 64;
+				uint64_t bit = uint64_t(1) << (entityIndex % 64);
+				if (index == tombstone) {
+					m_presence[word] &= ~bit;
+				}
+				else {
+					if (word >= m_presence.size())
+						m_presence.resize(word + 1, 0);
+					m_presence[word] |= bit;
+				}
+			}
+
+			if (!m_denseIndexListeners.empty())
+				NotifyDenseIndex(id, index);
+		}
+
+		void NotifyDenseIndex(EntityID id, DenseIndex index) {
+			for (IDenseIndexListener* listener : m_denseIndexListeners) {
+				if (index == tombstone)
+					listener->OnDenseIndexCleared(*this, id);
+				else
+					listener->OnDenseIndexSet(*this, id, index);
+			}
+		}
+
+		/*
+		* Returns the dense index for a given entity ID,
+		* or a tombstone (null) value if non-existent
+		*/
+		DenseIndex GetDenseIndex(EntityID id) const {
+			EntityIndex entityIndex = GetEntityIndex(id);
+			size_t page = entityIndex >> SPARSE_PAGE_SHIFT;
+
+			if (page < m_sparsePages.size() && m_sparsePages[page])
+				return m_sparsePages[page][entityIndex & SPARSE_PAGE_MASK];
+
+			return tombstone;
+		}
+
+	public:
+
+		SparseSet() {
+			// Avoids initial copies/allocation, feel free to alter size
+			m_dense.reserve(100);
+		}
+
+		T* Set(EntityID id, T obj) {
+			return &Emplace(id, std::move(obj));
+		}
+
+		/*
+		*  Constructs the element of the entity in place from the given
+		*  arguments, or overwrites it if the entity is already in the set.
+		*  Aggregates are brace initialized.
+		*/
+		template <typename... Args>
+		Reference Emplace(EntityID id, Args&&... args) {
+			// If index already exists, then simply overwrite
+			// that element in dense list, no need to delete
+			DenseIndex index = GetDenseIndex(id);
+			if (index != tombstone) {
+				if constexpr (std::is_constructible_v<T, Args...>)
+					m_dense[index] = T(std::forward<Args>(args)...);
+				else
+					m_dense[index] = T{ std::forward<Args>(args)... };
+				m_denseToEntity[index] = id;
+
+				if constexpr (Traits::TrackChanges)
+					m_changedTicks[index] = CurrentTick();
+
+				return m_dense[index];
+			}
+
+			BSEECS_ASSERT(m_dense.size() < tombstone, "Sparse set full, DenseIndex type is too small");
+
+			// New index will be the back of the dense list
+			SetDenseIndex(id, static_cast<DenseIndex>(m_dense.size()));
+
+			m_denseToEntity.push_back(id);
+			if constexpr (Traits::TrackChanges) {
+				m_addedTicks.push_back(CurrentTick());
+				m_changedTicks.push_back(m_addedTicks.back());
+			}
+
+			if constexpr (std::is_constructible_v<T, Args...>)
+				return m_dense.emplace_back(std::forward<Args>(args)...);
+			else
+				return m_dense.emplace_back(T{ std::forward<Args>(args)... });
+		}
+
+		/*
+		*  Appends 'count' consecutive entities starting at 'first', none of
+		*  which may already be in the set, with valueAt(i) as the component
+		*  of the i-th one. Storage is reserved once for the whole range.
+		*/
+		template <typename Func>
+		void AppendRange(EntityID first, size_t count, Func&& valueAt) {
+			BSEECS_ASSERT(m_dense.size() + count < tombstone, "Sparse set full, DenseIndex type is too small");
+
+			m_dense.reserve(m_dense.size() + count);
+			m_denseToEntity.reserve(m_denseToEntity.size() + count);
+			if constexpr (Traits::TrackChanges) {
+				m_addedTicks.resize(m_addedTicks.size() + count, CurrentTick());
+				m_changedTicks.resize(m_changedTicks.size() + count, CurrentTick());
+			}
+
+			EntityIndex firstIndex = GetEntityIndex(first);
+			EntityGeneration generation = GetEntityGeneration(first);
+			for (size_t i = 0; i < count; i++) {
+				EntityID id = MakeEntityID(firstIndex + static_cast<EntityIndex>(i), generation);
+				SetDenseIndex(id, static_cast<DenseIndex>(m_dense.size()));
+
+				m_dense.push_back(valueAt(i));
+				m_denseToEntity.push_back(id);
+			}
+		}
+
+		T* Get(EntityID id) {
+			static_assert(std::is_reference_v<Reference>,
+				"Storage elements have no address, use GetRef()");
+			DenseIndex index = GetDenseIndex(id);
+			return (index != tombstone) ? &m_dense[index] : nullptr;
+		}
+
+		Reference GetRef(EntityID id)
+		{
+			DenseIndex index = GetDenseIndex(id);
+			return m_dense[index];
+			//return (index != tombstone) ? m_dense[index] : nullptr;
+		}
+
+
+		EntityID GetEntity(EntityID compId)
+		{
+			return m_denseToEntity[compId];
+		}
+		
+		void Delete(EntityID id) override {
+
+			DenseIndex deletedIndex = GetDenseIndex(id);
+			BSEECS_ASSERT(deletedIndex != tombstone && !m_dense.empty(), "Trying to delete non-existent entity in sparse set");
+
+			SetDenseIndex(m_denseToEntity.back(), deletedIndex);
+			SetDenseIndex(id, tombstone);
+
+			// Move the last element into the hole, the moved-from one is popped
+			if (deletedIndex != m_dense.size() - 1) {
+				m_dense[deletedIndex] = std::move(m_dense.back());
+				m_denseToEntity[deletedIndex] = m_denseToEntity.back();
+				if constexpr (Traits::TrackChanges) {
+					m_addedTicks[deletedIndex] = m_addedTicks.back();
+					m_changedTicks[deletedIndex] = m_changedTicks.back();
+				}
+			}
+
+			m_dense.pop_back();
+			m_denseToEntity.pop_back();
+			if constexpr (Traits::TrackChanges) {
+				m_addedTicks.pop_back();
+				m_changedTicks.pop_back();
+			}
+		}
+
+		/*
+		*  Removes every given entity.
+		* 
+		*  Elements past the first removed one are compacted in a single
+		*  pass, which keeps the relative order of the remaining ones. When
+		*  that tail is long compared to the number of removals, each
+		*  removal is a swap-and-pop instead, like Delete(), and the order
+		*  is not kept.
+		*/
+		void DeleteBulk(Span<const EntityID> ids) override {
+			if (ids.empty())
+				return;
+
+			size_t first = m_dense.size();
+			for (EntityID id : ids) {
+				DenseIndex index = GetDenseIndex(id);
+				BSEECS_ASSERT(index != tombstone, "Trying to delete non-existent entity in sparse set");
+				first = std::min(first, size_t(index));
+			}
+
+			if (ids.size() * 8 < m_dense.size() - first) {
+				for (EntityID id : ids)
+					Delete(id);
+				return;
+			}
+
+			for (EntityID id : ids)
+				SetDenseIndex(id, tombstone);
+
+			size_t write = first;
+			for (size_t read = first; read < m_dense.size(); read++) {
+				EntityID id = m_denseToEntity[read];
+				if (GetDenseIndex(id) == tombstone)
+					continue;
+
+				if (write != read) {
+					m_dense[write] = std::move(m_dense[read]);
+					m_denseToEntity[write] = id;
+					if constexpr (Traits::TrackChanges) {
+						m_addedTicks[write] = m_addedTicks[read];
+						m_changedTicks[write] = m_changedTicks[read];
+					}
+					SetDenseIndex(id, static_cast<DenseIndex>(write));
+				}
+				write++;
+			}
+
+			while (m_dense.size() > write)
+				m_dense.pop_back();
+			m_denseToEntity.resize(write);
+			if constexpr (Traits::TrackChanges) {
+				m_addedTicks.resize(write);
+				m_changedTicks.resize(write);
+			}
+		}
+
+		/*
+		*  Removes every entity, keeping the dense storage and the sparse
+		*  pages allocated for reuse. Only the sparse entries of entities
+		*  in the set are reset.
+		*/
+		void Clear() override {
+			for (EntityID id : m_denseToEntity)
+				SetDenseIndex(id, tombstone);
+
+			m_dense.clear();
+			m_denseToEntity.clear();
+			m_addedTicks.clear();
+			m_changedTicks.clear();
+		}
+
+		bool IsEmpty() const {
+			return m_dense.empty();
+		}
+
+		size_t Size() const {
+			return m_dense.size();
+		}
+
+		bool Contains(EntityID id) const {
+			if constexpr (Traits::PresenceBits) {
+				size_t word = GetEntityIndex(id) / 64;
+				return word < m_presence.size() && (m_presence[word] >> (GetEntityIndex(id) % 64)) & 1;
+			}
+			else {
+				return GetDenseIndex(id) != tombstone;
+			}
+		}
+
+		static constexpr bool HasPresenceBits = Traits::PresenceBits;
+
+		// Presence bits by entity index, empty unless HasPresenceBits
+		const std::vector<uint64_t>& PresenceWords() const {
+			return m_presence;
+		}
+
+		static constexpr bool TracksChanges = Traits::TrackChanges;
+
+		// Clock read when stamping ticks, set by the ECS on registration
+		void SetTickSource(const std::atomic<Tick>* tickSource) {
+			m_tickSource = tickSource;
+		}
+
+		// Stamps the element of the entity as changed now, if it is in the set
+		void MarkChanged(EntityID id) {
+			if constexpr (Traits::TrackChanges) {
+				DenseIndex index = GetDenseIndex(id);
+				if (index != tombstone)
+					m_changedTicks[index] = CurrentTick();
+			}
+		}
+
+		void MarkChangedAt(size_t index) {
+			if constexpr (Traits::TrackChanges)
+				m_changedTicks[index] = CurrentTick();
+		}
+
+		// Stamps the elements of the dense range [begin, end) as changed now
+		void MarkChangedRange(size_t begin, size_t end) {
+			if constexpr (Traits::TrackChanges)
+				std::fill(m_changedTicks.begin() + begin, m_changedTicks.begin() + end, CurrentTick());
+		}
+
+		// Tick at which the entity's element was added, it must be in the set
+		Tick AddedTick(EntityID id) const {
+			static_assert(Traits::TrackChanges, "Component does not track changes, see ComponentTraits::TrackChanges");
+			return m_addedTicks[GetDenseIndex(id)];
+		}
+
+		// Tick at which the entity's element was last changed, it must be in the set
+		Tick ChangedTick(EntityID id) const {
+			static_assert(Traits::TrackChanges, "Component does not track changes, see ComponentTraits::TrackChanges");
+			return m_changedTicks[GetDenseIndex(id)];
+		}
+
+		// Position of the entity in the dense list, or tombstone
+		DenseIndex IndexOf(EntityID id) const {
+			return GetDenseIndex(id);
+		}
+
+		/*
+		*  Swaps two elements of the dense list, along with their
+		*  entities and sparse entries
+		*/
+		void SwapDense(size_t lhs, size_t rhs) {
+			if (lhs == rhs)
+				return;
+
+			SetDenseIndex(m_denseToEntity[lhs], static_cast<DenseIndex>(rhs));
+			SetDenseIndex(m_denseToEntity[rhs], static_cast<DenseIndex>(lhs));
+
+			using std::swap; // Storage references may be proxies with their own swap
+			swap(m_dense[lhs], m_dense[rhs]);
+			std::swap(m_denseToEntity[lhs], m_denseToEntity[rhs]);
+			if constexpr (Traits::TrackChanges) {
+				std::swap(m_addedTicks[lhs], m_addedTicks[rhs]);
+				std::swap(m_changedTicks[lhs], m_changedTicks[rhs]);
+			}
+		}
+
+		/*
+		*  Reorders the dense list by the given comparator, taking either
+		*  two components (const T&) or two EntityIDs. Entities, sparse
+		*  entries and ticks follow their elements.
+		* 
+		*  Heap sort through SwapDense(): in place and allocation free,
+		*  but not stable.
+		*/
+		template <typename Compare>
+		void Sort(Compare cmp) {
+			const Storage& dense = m_dense;
+			auto less = [&](size_t lhs, size_t rhs) -> bool {
+				if constexpr (std::is_invocable_v<Compare&, const T&, const T&>)
+					return cmp(dense[lhs], dense[rhs]);
+				else
+					return cmp(m_denseToEntity[lhs], m_denseToEntity[rhs]);
+			};
+
+			auto siftDown = [&](size_t root, size_t size) {
+				for (size_t child; (child = 2 * root + 1) < size; root = child) {
+					if (child + 1 < size && less(child, child + 1))
+						child++;
+					if (!less(root, child))
+						return;
+					SwapDense(root, child);
+				}
+			};
+
+			size_t size = m_dense.size();
+			for (size_t i = size / 2; i-- > 0;)
+				siftDown(i, size);
+
+			for (size_t end = size; end-- > 1;) {
+				SwapDense(0, end);
+				siftDown(0, end);
+			}
+		}
+
+		/*
+		*  Reorders the dense list so the entities it shares with 'other'
+		*  come first, in the same order as in 'other'. The others follow
+		*  in no particular order. Joins over both pools then walk the two
+		*  dense lists sequentially.
+		*/
+		template <typename OtherSet>
+		void SortAs(const OtherSet& other) {
+			size_t position = 0;
+			for (EntityID id : other.Entities()) {
+				DenseIndex index = GetDenseIndex(id);
+				if (index != tombstone)
+					SwapDense(index, position++);
+			}
+		}
+
+		// Entity owning each element of the dense list
+		const std::vector<EntityID>& Entities() const {
+			return m_denseToEntity;
+		}
+
+		// Dense list
+		Storage& Data()
+		{
+			return m_dense;
+		}
+
+		void PrintDense() {
+			std::stringstream ss;
+			std::string delim = "";
+			for (size_t i = 0; i < m_dense.size(); i++) {
+				ss << delim << m_dense[i];
+				if (delim.empty())
+					delim = ", ";
+			}
+			BSEECS_INFO("[" << ss.str() << "]");
+		}
+
+	};
+
+
+	/*
+	*  Query terms, usable among the components of View() and ForEach():
+	* 
+	*  - Exclude<Ts...>: skips entities having any of Ts
+	*  - Optional<Ts...>: doesn't filter, hands out Ts* (null when missing)
+	*    after the required components
+	* 
+	*  ecs.ForEach<Mesh, Optional<Tint>>([](Mesh& mesh, Tint* tint) { ... });
+	*  ecs.ForEach<A, B, Exclude<Stunned>>([](A& a, B& b) { ... });
+	*/
+	template <typename... Ts>
+	struct Exclude {};
+
+	template <typename... Ts>
+	struct Optional {};
+
+	/*
+	*  Change detection terms, for components with ComponentTraits::TrackChanges.
+	*  Required like plain components, and only match entities whose component
+	*  was added (Added) or added or written to (Changed) since the view's
+	*  tick, see BasicView::Since().
+	* 
+	*  ecs.ForEach<Changed<Transform>, Collider>([](const Transform& t, Collider& c) { ... });
+	*/
+	template <typename... Ts>
+	struct Changed {};
+
+	template <typename... Ts>
+	struct Added {};
+
+	namespace internal {
+
+		template <typename T>
+		struct ChangedFilter {};
+
+		template <typename T>
+		struct AddedFilter {};
+
+		template <typename... Tuples>
+		using TupleCat = decltype(std::tuple_cat(std::declval<Tuples>()...));
+
+		// Splits a single term into required, excluded and optional
+		// components, and tick filters on required ones
+		template <typename Term>
+		struct QueryTerm {
+			using Includes = std::tuple<Term>;
+			using Excludes = std::tuple<>;
+			using Optionals = std::tuple<>;
+			using Filters = std::tuple<>;
+		};
+
+		template <typename... Ts>
+		struct QueryTerm<Exclude<Ts...>> {
+			using Includes = std::tuple<>;
+			using Excludes = std::tuple<Ts...>;
+			using Optionals = std::tuple<>;
+			using Filters = std::tuple<>;
+		};
+
+		template <typename... Ts>
+		struct QueryTerm<Optional<Ts...>> {
+			using Includes = std::tuple<>;
+			using Excludes = std::tuple<>;
+			using Optionals = std::tuple<Ts...>;
+			using Filters = std::tuple<>;
+		};
+
+		template <typename... Ts>
+		struct QueryTerm<Changed<Ts...>> {
+			using Includes = std::tuple<Ts...>;
+			using Excludes = std::tuple<>;
+			using Optionals = std::tuple<>;
+			using Filters = std::tuple<ChangedFilter<Ts>...>;
+		};
+
+		template <typename... Ts>
+		struct QueryTerm<Added<Ts...>> {
+			using Includes = std::tuple<Ts...>;
+			using Excludes = std::tuple<>;
+			using Optionals = std::tuple<>;
+			using Filters = std::tuple<AddedFilter<Ts>...>;
+		};
+
+		template <typename... Terms>
+		struct QueryTerms {
+			using Includes = TupleCat<typename QueryTerm<Terms>::Includes...>;
+			using Excludes = TupleCat<typename QueryTerm<Terms>::Excludes...>;
+			using Optionals = TupleCat<typename QueryTerm<Terms>::Optionals...>;
+			using Filters = TupleCat<typename QueryTerm<Terms>::Filters...>;
+		};
+
+	}
+
+	template <typename Includes, typename Excludes, typename Optionals, typename Filters>
+	class BasicView;
+
+	/*
+	*  Iterates the entities that have all of the given components,
+	*  see the query terms above for exclusions and optional components.
+	* 
+	*  Pools are looked up once, when the view is created. Iteration is
+	*  driven by the entity list of the smallest required pool (picked when
+	*  iteration starts), entities missing any other required component or
+	*  having an excluded one are skipped.
+	* 
+	*  - for (auto& [id, a, c] : ecs.View<A, C>()) { ... }
+	*  - ecs.View<A, C>().Each([](EntityID id, A& a, C& c) { ... });
+	*  - ecs.View<A, const C>(): C is handed out as const C&
+	* 
+	*  Same as ForEach(), the pools must not be structurally modified
+	*  while iterating.
+	*/
+	template <typename... Terms>
+	using View = BasicView<
+		typename internal::QueryTerms<Terms...>::Includes,
+		typename internal::QueryTerms<Terms...>::Excludes,
+		typename internal::QueryTerms<Terms...>::Optionals,
+		typename internal::QueryTerms<Terms...>::Filters>;
+
+	template <typename... Components, typename... Excludes, typename... Optionals, typename... Filters>
+	class BasicView<std::tuple<Components...>, std::tuple<Excludes...>, std::tuple<Optionals...>, std::tuple<Filters...>> {
+	public:
+
+		// Const components share the pool of the mutable type
+		template <typename T>
+		using Pool = SparseSet<std::remove_const_t<T>>;
+
+		using IncludePools = std::tuple<Pool<Components>*...>;
+		using ExcludePools = std::tuple<Pool<Excludes>*...>;
+		using OptionalPools = std::tuple<Pool<Optionals>*...>;
+
+	private:
+
+		static_assert(sizeof...(Components) > 0, "A view needs at least one required component");
+
+		IncludePools m_pools;
+		ExcludePools m_excludePools;
+		OptionalPools m_optionalPools;
+
+		// Changed/Added terms match ticks strictly after this one
+		Tick m_since = 0;
+
+		const std::vector<EntityID>& GetDrivingEntities() const {
+			const std::vector<EntityID>* smallest = nullptr;
+			((smallest = (!smallest || std::get<Pool<Components>*>(m_pools)->Size() < smallest->size())
+				? &std::get<Pool<Components>*>(m_pools)->Entities()
+				: smallest), ...);
+
+			return *smallest;
+		}
+
+		// One sparse lookup per pool, null if the entity lacks the component
+		std::tuple<Components*...> Find(EntityID id) const {
+			return { std::get<Pool<Components>*>(m_pools)->Get(id)... };
+		}
+
+		std::tuple<Optionals*...> FindOptionals([[maybe_unused]] EntityID id) const {
+			return { std::get<Pool<Optionals>*>(m_optionalPools)->Get(id)... };
+		}
+
+		template <typename T>
+		bool PassesFilter(internal::ChangedFilter<T>*, EntityID id) const {
+			return std::get<Pool<T>*>(m_pools)->ChangedTick(id) > m_since;
+		}
+
+		template <typename T>
+		bool PassesFilter(internal::AddedFilter<T>*, EntityID id) const {
+			return std::get<Pool<T>*>(m_pools)->AddedTick(id) > m_since;
+		}
+
+		bool Matches([[maybe_unused]] EntityID id, const std::tuple<Components*...>& components) const {
+			return ((std::get<Components*>(components) != nullptr) && ...)
+				&& !(std::get<Pool<Excludes>*>(m_excludePools)->Contains(id) || ...)
+				&& (PassesFilter(static_cast<Filters*>(nullptr), id) && ...);
+		}
+
+		// Components handed out as mutable count as changed
+		void MarkChanged(EntityID id) const {
+			([&]() {
+				if constexpr (!std::is_const_v<Components> && Pool<Components>::TracksChanges)
+					std::get<Pool<Components>*>(m_pools)->MarkChanged(id);
+			}(), ...);
+
+			([&]() {
+				if constexpr (!std::is_const_v<Optionals> && Pool<Optionals>::TracksChanges)
+					std::get<Pool<Optionals>*>(m_optionalPools)->MarkChanged(id);
+			}(), ...);
+		}
+
+	public:
+
+		using value_type = std::tuple<EntityID, Components&..., Optionals*...>;
+
+		class Iterator {
+		private:
+			const BasicView* m_view = nullptr;
+			const EntityID* m_current = nullptr;
+			const EntityID* m_end = nullptr;
+
+			std::tuple<Components*...> m_components;
+
+			// Rebuilt on dereference, tuples of references cannot be reassigned
+			mutable std::optional<value_type> m_value;
+
+			void SkipNonMatching() {
+				for (; m_current != m_end; ++m_current) {
+					m_components = m_view->Find(*m_current);
+					if (m_view->Matches(*m_current, m_components))
+						return;
+				}
+			}
+
+		public:
+			Iterator(const BasicView* view, const EntityID* current, const EntityID* end)
+				: m_view(view), m_current(current), m_end(end)
+			{
+				SkipNonMatching();
+			}
+
+			value_type& operator*() const {
+				m_view->MarkChanged(*m_current);
+				std::apply([this](Optionals*... optionals) {
+					m_value.emplace(*m_current, *std::get<Components*>(m_components)..., optionals...);
+				}, m_view->FindOptionals(*m_current));
+
+				return *m_value;
+			}
+
+			Iterator& operator++() {
+				++m_current;
+				SkipNonMatching();
+				return *this;
+			}
+
+			bool operator==(const Iterator& other) const {
+				return m_current == other.m_current;
+			}
+
+			bool operator!=(const Iterator& other) const {
+				return m_current != other.m_current;
+			}
+		};
+
+		BasicView(IncludePools pools, ExcludePools excludePools, OptionalPools optionalPools, Tick since = 0)
+			: m_pools(pools), m_excludePools(excludePools), m_optionalPools(optionalPools), m_since(since)
+		{
+		}
+
+		/*
+		*  Returns a copy of the view whose Changed/Added terms match ticks
+		*  after 'tick'. Views made while a Scheduler system runs default to
+		*  the end of that system's previous run, others to 0.
+		*/
+		BasicView Since(Tick tick) const {
+			BasicView view = *this;
+			view.m_since = tick;
+			return view;
+		}
+
+		Iterator begin() const {
+			const std::vector<EntityID>& entities = GetDrivingEntities();
+			return Iterator(this, entities.data(), entities.data() + entities.size());
+		}
+
+		Iterator end() const {
+			const std::vector<EntityID>& entities = GetDrivingEntities();
+			const EntityID* last = entities.data() + entities.size();
+			return Iterator(this, last, last);
+		}
+
+		/*
+		*  Executes the passed lambda on every matching entity, same forms as ECS::ForEach()
+		* 
+		*  When some required pools keep presence bits (tag components do by
+		*  default), and scanning them is shorter than the smallest pool, their
+		*  bitsets are intersected a word at a time instead and the other pools
+		*  are looked up per candidate, visiting entities in index order.
+		*/
+		template <typename Func>
+		void Each(Func&& func) const {
+			const std::vector<EntityID>& entities = GetDrivingEntities();
+
+			if constexpr (sizeof...(Components) > 1 && PRESENCE_POOLS > 0) {
+				std::array<const std::vector<uint64_t>*, PRESENCE_POOLS> presence = GetPresencePools();
+
+				size_t words = presence[0]->size();
+				for (const std::vector<uint64_t>* bits : presence)
+					words = std::min(words, bits->size());
+
+				if (words < entities.size()) {
+					EachInPresence(presence, words, func);
+					return;
+				}
+			}
+
+			EachIn(entities.data(), entities.data() + entities.size(), func);
+		}
+
+		/*
+		*  Same as Each(), restricted to the dense range [begin, end) of the
+		*  Driver pool. Used to split the work in ECS::ParallelForEach().
+		*/
+		template <typename Driver, typename Func>
+		void EachInRange(size_t begin, size_t end, Func&& func) const {
+			const std::vector<EntityID>& entities = std::get<Pool<Driver>*>(m_pools)->Entities();
+			EachIn(entities.data() + begin, entities.data() + end, func);
+		}
+
+	private:
+
+		template <typename Func>
+		void EachIn(const EntityID* first, const EntityID* last, Func& func) const {
+			for (; first != last; ++first)
+			{
+				EntityID id = *first;
+				std::tuple<Components*...> components = Find(id);
+				if (!Matches(id, components))
+					continue;
+
+				Invoke(func, id, components);
+			}
+		}
+
+		// Required pools keeping presence bits
+		static constexpr size_t PRESENCE_POOLS = (size_t(0) + ... + size_t(Pool<Components>::HasPresenceBits));
+
+		std::array<const std::vector<uint64_t>*, PRESENCE_POOLS> GetPresencePools() const {
+			std::array<const std::vector<uint64_t>*, PRESENCE_POOLS> presence{};
+			size_t count = 0;
+			([&]() {
+				if constexpr (Pool<Components>::HasPresenceBits)
+					presence[count++] = &std::get<Pool<Components>*>(m_pools)->PresenceWords();
+			}(), ...);
+
+			return presence;
+		}
+
+		template <typename Func>
+		void EachInPresence(const std::array<const std::vector<uint64_t>*, PRESENCE_POOLS>& presence, size_t words, Func& func) const {
+			using Lead = std::tuple_element_t<0, std::tuple<Components...>>;
+
+			const std::vector<EntityID>& leadEntities = std::get<Pool<Lead>*>(m_pools)->Entities();
+
+			for (size_t word = 0; word < words; word++)
+			{
+				uint64_t bits = (*presence[0])[word];
+				for (size_t pool = 1; pool < presence.size(); pool++)
+					bits &= (*presence[pool])[word];
+
+				for (; bits != 0; bits &= bits - 1)
+				{
+					// Pools are keyed by index only, the generation comes from the lead pool
+					EntityID lookup = MakeEntityID(static_cast<EntityIndex>(word * 64 + internal::CountTrailingZeros(bits)), 0);
+					std::tuple<Components*...> components = Find(lookup);
+					if (!Matches(lookup, components))
+						continue;
+
+					Invoke(func, leadEntities[std::get<Pool<Lead>*>(m_pools)->IndexOf(lookup)], components);
+				}
+			}
+		}
+
+		template <typename Func>
+		void Invoke(Func& func, EntityID id, const std::tuple<Components*...>& components) const {
+			MarkChanged(id);
+
+			if constexpr (sizeof...(Optionals) == 0)
+			{
+				internal::InvokeEach(func, id, *std::get<Components*>(components)...);
+			}
+
+			else
+			{
+				std::tuple<Optionals*...> optionals = FindOptionals(id);
+				internal::InvokeEach(func, id, *std::get<Components*>(components)..., std::get<Optionals*>(optionals)...);
+			}
+		}
+	};
+
+
+	/*
+	*  Owning group over a set of component pools, see ECS::Group().
+	* 
+	*  Keeps every entity having all the owned components packed at the
+	*  front of each owned pool, in the same order, by swapping elements as
+	*  components are added and removed. Iterating the group is a linear walk
+	*  over the first Size() elements of each dense list, without any sparse
+	*  lookup.
+	* 
+	*  A pool can be owned by a single group, and the order of its dense
+	*  list must not be changed by anything else while the group exists.
+	*/
+	template <typename... Owned>
+	class Group : public IComponentListener {
+	private:
+
+		static_assert(sizeof...(Owned) > 0, "A group must own at least one component");
+
+		using Lead = std::tuple_element_t<0, std::tuple<Owned...>>;
+
+		std::tuple<SparseSet<Owned>*...> m_pools;
+
+		// Number of packed entities, at the front of every owned pool
+		size_t m_size = 0;
+
+		bool IsPacked(EntityID id) const {
+			size_t index = std::get<SparseSet<Lead>*>(m_pools)->IndexOf(id);
+			return index != SparseSet<Lead>::tombstone && index < m_size;
+		}
+
+	public:
+
+		explicit Group(SparseSet<Owned>&... pools)
+			: m_pools(&pools...)
+		{
+			// Pack the entities already matching, driven by the smallest pool.
+			// Swaps only move entities that have been visited already.
+			const std::vector<EntityID>* smallest = nullptr;
+			((smallest = (!smallest || pools.Size() < smallest->size()) ? &pools.Entities() : smallest), ...);
+
+			for (size_t i = 0; i < smallest->size(); i++)
+				OnAdd((*smallest)[i]);
+		}
+
+		void OnAdd(EntityID id) override {
+			if (!(std::get<SparseSet<Owned>*>(m_pools)->Contains(id) && ...) || IsPacked(id))
+				return;
+
+			(std::get<SparseSet<Owned>*>(m_pools)->SwapDense(std::get<SparseSet<Owned>*>(m_pools)->IndexOf(id), m_size), ...);
+			m_size++;
+		}
+
+		void OnRemove(EntityID id) override {
+			if (!IsPacked(id))
+				return;
+
+			m_size--;
+			(std::get<SparseSet<Owned>*>(m_pools)->SwapDense(std::get<SparseSet<Owned>*>(m_pools)->IndexOf(id), m_size), ...);
+		}
+
+		void OnClear() override {
+			m_size = 0;
+		}
+
+		size_t Size() const {
+			return m_size;
+		}
+
+		// Packed entities, only the first Size() are part of the group
+		const std::vector<EntityID>& Entities() const {
+			return std::get<SparseSet<Lead>*>(m_pools)->Entities();
+		}
+
+		/*
+		*  Executes the passed lambda on every entity of the group,
+		*  same forms as ECS::ForEach()
+		*/
+		template <typename Func>
+		void Each(Func&& func) const {
+			const std::vector<EntityID>& entities = Entities();
+			auto dense = std::tie(std::get<SparseSet<Owned>*>(m_pools)->Data()...);
+			for (size_t i = 0; i < m_size; i++) {
+				(std::get<SparseSet<Owned>*>(m_pools)->MarkChangedAt(i), ...);
+				internal::InvokeEach(func, entities[i], std::get<typename SparseSet<Owned>::Storage&>(dense)[i]...);
+			}
+		}
+	};
+
+
+	/*
+	*  Dense to dense links between two pools, see ECS::LinkSiblings().
+	* 
+	*  Stores, for every element of the primary pool, the dense index of
+	*  the same entity in the sibling pool, so reaching the sibling is a
+	*  single indexed load instead of going through the entity and the
+	*  sparse pages. The links are patched whenever an element of either
+	*  pool moves.
+	*/
+	template <typename Primary, typename Sibling>
+	class SiblingLinks : public IDenseIndexListener {
+	public:
+
+		using DenseIndex = typename SparseSet<Sibling>::DenseIndex;
+
+		static constexpr DenseIndex tombstone = SparseSet<Sibling>::tombstone;
+
+	private:
+
+		static_assert(!std::is_same_v<Primary, Sibling>, "A pool cannot be linked to itself");
+
+		SparseSet<Primary>* m_primary;
+		SparseSet<Sibling>* m_sibling;
+
+		// Indexed by primary dense index, only the first m_primary->Size() are meaningful
+		std::vector<DenseIndex> m_links;
+
+	public:
+
+		SiblingLinks(SparseSet<Primary>& primary, SparseSet<Sibling>& sibling)
+			: m_primary(&primary), m_sibling(&sibling)
+		{
+			const std::vector<EntityID>& entities = primary.Entities();
+			m_links.resize(entities.size());
+			for (size_t i = 0; i < entities.size(); i++)
+				m_links[i] = sibling.IndexOf(entities[i]);
+
+			primary.AddDenseIndexListener(this);
+			sibling.AddDenseIndexListener(this);
+		}
+
+		void OnDenseIndexSet(const ISparseSet& pool, EntityID id, size_t index) override {
+			if (&pool == m_primary) {
+				if (index >= m_links.size())
+					m_links.resize(index + 1, tombstone);
+
+				m_links[index] = m_sibling->IndexOf(id);
+				return;
+			}
+
+			size_t primaryIndex = m_primary->IndexOf(id);
+			if (primaryIndex != SparseSet<Primary>::tombstone)
+				m_links[primaryIndex] = static_cast<DenseIndex>(index);
+		}
+
+		void OnDenseIndexCleared(const ISparseSet& pool, EntityID id) override {
+			if (&pool == m_primary)
+				return;
+
+			size_t primaryIndex = m_primary->IndexOf(id);
+			if (primaryIndex != SparseSet<Primary>::tombstone)
+				m_links[primaryIndex] = tombstone;
+		}
+
+		// Dense index in the sibling pool, or tombstone if the entity lacks it
+		DenseIndex IndexOf(size_t primaryIndex) const {
+			return m_links[primaryIndex];
+		}
+
+		// Sibling component of the primary element, which must have one
+		Sibling& Get(size_t primaryIndex) {
+			return m_sibling->Data()[m_links[primaryIndex]];
+		}
+	};
+
+
+	/*
+	*  Non-owning query result kept up to date incrementally, see ECS::Query().
+	* 
+	*  Holds its own list of the entities having all the given components,
+	*  updated from the Add()/Remove()/DeleteEntity() hooks of the ECS, so
+	*  iterating costs one step per match rather than per element of the
+	*  driving pool, and the pools' order is left untouched.
+	*/
+	template <typename... Components>
+	class CachedQuery : public IComponentListener {
+	private:
+
+		// Marker stored for every match, the set itself is the entity list
+		struct Match {};
+
+		std::tuple<SparseSet<Components>*...> m_pools;
+		SparseSet<Match> m_matches;
+
+	public:
+
+		explicit CachedQuery(SparseSet<Components>&... pools)
+			: m_pools(&pools...)
+		{
+			const std::vector<EntityID>* smallest = nullptr;
+			((smallest = (!smallest || pools.Size() < smallest->size()) ? &pools.Entities() : smallest), ...);
+
+			for (EntityID id : *smallest)
+				OnAdd(id);
+		}
+
+		void OnAdd(EntityID id) override {
+			if ((std::get<SparseSet<Components>*>(m_pools)->Contains(id) && ...) && !m_matches.Contains(id))
+				m_matches.Set(id, {});
+		}
+
+		void OnRemove(EntityID id) override {
+			if (m_matches.Contains(id))
+				m_matches.Delete(id);
+		}
+
+		void OnClear() override {
+			m_matches.Clear();
+		}
+
+		size_t Size() const {
+			return m_matches.Size();
+		}
+
+		const std::vector<EntityID>& Entities() const {
+			return m_matches.Entities();
+		}
+
+		/*
+		*  Executes the passed lambda on every matching entity,
+		*  same forms as ECS::ForEach()
+		*/
+		template <typename Func>
+		void Each(Func&& func) const {
+			for (EntityID id : m_matches.Entities()) {
+				(std::get<SparseSet<Components>*>(m_pools)->MarkChanged(id), ...);
+				internal::InvokeEach(func, id, *std::get<SparseSet<Components>*>(m_pools)->Get(id)...);
+			}
+		}
+	};
+
+
+	/*
+	*  Small work-stealing thread pool, used by ECS::ParallelForEach().
+	* 
+	*  Each worker owns a task queue: it pops from the back of its own queue
+	*  and steals from the front of the others once it runs dry. Threads
+	*  waiting on a TaskGroup keep running queued tasks instead of blocking,
+	*  so tasks can submit and wait on further work themselves.
+	*/
+	class ThreadPool {
+	public:
+
+		using Task = std::function<void()>;
+
+		// Tracks a batch of submitted tasks so it can be waited on
+		class TaskGroup {
+		private:
+			friend class ThreadPool;
+			std::atomic<size_t> m_pending{ 0 };
+
+		public:
+			bool IsDone() const {
+				return m_pending.load(std::memory_order_acquire) == 0;
+			}
+		};
+
+	private:
+
+		struct QueuedTask {
+			TaskGroup* m_group;
+			Task m_task;
+		};
+
+		struct Queue {
+			std::mutex m_mutex;
+			std::deque<QueuedTask> m_tasks;
+		};
+
+		// One queue per worker, or a single one when there are no workers
+		std::vector<std::unique_ptr<Queue>> m_queues;
+		std::vector<std::thread> m_workers;
+
+		std::atomic<size_t> m_queuedTasks{ 0 };
+		std::atomic<size_t> m_nextQueue{ 0 };
+
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wakeUp;
+		bool m_stopping = false;
+
+		static constexpr size_t NOT_A_WORKER = std::numeric_limits<size_t>::max();
+
+		// Worker index of the calling thread in this pool
+		size_t CurrentWorker() const {
+			return s_currentPool == this ? s_currentWorker : NOT_A_WORKER;
+		}
+
+		static inline thread_local const ThreadPool* s_currentPool = nullptr;
+		static inline thread_local size_t s_currentWorker = NOT_A_WORKER;
+
+		bool TryPop(size_t queueIndex, bool fromBack, QueuedTask& out) {
+			Queue& queue = *m_queues[queueIndex];
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+			if (queue.m_tasks.empty())
+				return false;
+
+			if (fromBack) {
+				out = std::move(queue.m_tasks.back());
+				queue.m_tasks.pop_back();
+			}
+			else {
+				out = std::move(queue.m_tasks.front());
+				queue.m_tasks.pop_front();
+			}
+			return true;
+		}
+
+		/*
+		*  Runs a single queued task, own queue first, then stealing.
+		*  Returns false if every queue was empty.
+		*/
+		bool TryRunOne() {
+			size_t worker = CurrentWorker();
+			size_t start = worker != NOT_A_WORKER ? worker : 0;
+
+			QueuedTask queued;
+			bool found = false;
+			for (size_t i = 0; i < m_queues.size() && !found; i++)
+				found = TryPop((start + i) % m_queues.size(), i == 0 && worker != NOT_A_WORKER, queued);
+
+			if (!found)
+				return false;
+
+			m_queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+			queued.m_task();
+			queued.m_group->m_pending.fetch_sub(1, std::memory_order_acq_rel);
+			return true;
+		}
+
+		void WorkerLoop(size_t index) {
+			s_currentPool = this;
+			s_currentWorker = index;
+
+			while (true) {
+				if (TryRunOne())
+					continue;
+
+				std::unique_lock<std::mutex> lock(m_sleepMutex);
+				m_wakeUp.wait(lock, [this]() {
+					return m_stopping || m_queuedTasks.load(std::memory_order_relaxed) > 0;
+				});
+
+				if (m_stopping)
+					return;
+			}
+		}
+
+	public:
+
+		/*
+		*  @param(workerCount):
+		*  * Threads spawned besides the ones calling Wait(), which also
+		*    run tasks. Zero runs everything on the waiting thread.
+		*/
+		explicit ThreadPool(size_t workerCount) {
+			size_t queueCount = std::max<size_t>(workerCount, 1);
+			for (size_t i = 0; i < queueCount; i++)
+				m_queues.push_back(std::make_unique<Queue>());
+
+			for (size_t i = 0; i < workerCount; i++)
+				m_workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+		}
+
+		~ThreadPool() {
+			{
+				std::lock_guard<std::mutex> lock(m_sleepMutex);
+				m_stopping = true;
+			}
+			m_wakeUp.notify_all();
+
+			for (std::thread& worker : m_workers)
+				worker.join();
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		size_t WorkerCount() const {
+			return m_workers.size();
+		}
+
+		/*
+		*  Queues a task, workers push to their own queue,
+		*  other threads spread tasks round robin.
+		*/
+		void Submit(TaskGroup& group, Task task) {
+			size_t worker = CurrentWorker();
+			size_t queueIndex = worker != NOT_A_WORKER
+				? worker
+				: m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+
+			group.m_pending.fetch_add(1, std::memory_order_relaxed);
+			{
+				Queue& queue = *m_queues[queueIndex];
+				std::lock_guard<std::mutex> lock(queue.m_mutex);
+				queue.m_tasks.push_back({ &group, std::move(task) });
+			}
+			m_queuedTasks.fetch_add(1, std::memory_order_relaxed);
+
+			// Empty critical section, so a worker can't miss the wake up
+			// between checking m_queuedTasks and going to sleep
+			{
+				std::lock_guard<std::mutex> lock(m_sleepMutex);
+			}
+			m_wakeUp.notify_one();
+		}
+
+		/*
+		*  Runs queued tasks on the calling thread until every task
+		*  of the group is done.
+		*/
+		void Wait(TaskGroup& group) {
+			while (!group.IsDone()) {
+				if (!TryRunOne())
+					std::this_thread::yield();
+			}
+		}
+	};
+
+
+	// Base class allows runtime polymorphism
+	class IEventChannel {
+	public:
+		virtual ~IEventChannel() = default;
+		virtual void Update() = 0;
+	};
+
+	/*
+	*  Read position of one consumer of an EventChannel<T>. Every reader
+	*  sees every event once, independently of the other readers.
+	*/
+	template <typename T>
+	class EventReader {
+	private:
+		template <typename>
+		friend class EventChannel;
+
+		// Sequence number of the next event to read
+		size_t m_cursor = 0;
+	};
+
+	/*
+	*  Typed event queue, see ECS::Events().
+	* 
+	*  Send() appends to a buffer private to the calling thread, so any
+	*  thread (e.g. ParallelForEach() workers) can send without locking.
+	*  Update(), called once per frame, moves the sent events into the
+	*  readable buffer, which stays readable for two frames so readers
+	*  running before or after the senders each frame see every event.
+	* 
+	*  Readers never look at the buffers being written to, so Read() and
+	*  Send() never contend; only Update() must run while neither does.
+	* 
+	*  Events from one thread keep their order, events from different
+	*  threads are grouped by thread.
+	*/
+	template <typename T>
+	class EventChannel : public IEventChannel {
+	private:
+
+		// Readable events, of the previous and of the last frame
+		std::vector<T> m_older;
+		std::vector<T> m_newer;
+
+		// Sequence number of the first event of each readable buffer
+		size_t m_olderStart = 0;
+		size_t m_newerStart = 0;
+
+		// One per thread that sent an event, registered on its first Send().
+		// The threads only hold weak references, expiring with the channel.
+		std::vector<std::shared_ptr<std::vector<T>>> m_threadBuffers;
+		std::mutex m_threadBuffersMutex;
+
+		const uint64_t m_id = internal::NextEventChannelID();
+
+		struct ThreadEntry {
+			uint64_t m_channelID; // Addresses can be reused, IDs are not
+			std::vector<T>* m_buffer;
+			std::weak_ptr<std::vector<T>> m_owner;
+		};
+
+		std::vector<T>& ThreadBuffer() {
+			// Channels of this type the calling thread sent to
+			static thread_local std::vector<ThreadEntry> s_buffers;
+			for (const ThreadEntry& entry : s_buffers) {
+				if (entry.m_channelID == m_id)
+					return *entry.m_buffer;
+			}
+
+			// Forget destroyed channels, so worlds rebuilt over and over
+			// don't make the registry, and every Send(), grow
+			s_buffers.erase(std::remove_if(s_buffers.begin(), s_buffers.end(),
+				[](const ThreadEntry& entry) { return entry.m_owner.expired(); }), s_buffers.end());
+
+			std::shared_ptr<std::vector<T>> buffer = std::make_shared<std::vector<T>>();
+			{
+				std::lock_guard<std::mutex> lock(m_threadBuffersMutex);
+				m_threadBuffers.push_back(buffer);
+			}
+
+			s_buffers.push_back({ m_id, buffer.get(), buffer });
+			return *buffer;
+		}
+
+	public:
+
+		EventChannel() = default;
+
+		EventChannel(const EventChannel&) = delete;
+		EventChannel& operator=(const EventChannel&) = delete;
+
+		// Readable from the next Update() on
+		void Send(const T& event) {
+			ThreadBuffer().push_back(event);
+		}
+
+		void Send(T&& event) {
+			ThreadBuffer().push_back(std::move(event));
+		}
+
+		template <typename... Args>
+		void Emplace(Args&&... args) {
+			ThreadBuffer().emplace_back(std::forward<Args>(args)...);
+		}
+
+		/*
+		*  Drops the events of the previous frame and makes the ones sent
+		*  since the last Update() readable. Buffers keep their capacity.
+		*/
+		void Update() override {
+			std::swap(m_older, m_newer);
+			m_olderStart = m_newerStart;
+			m_newerStart = m_olderStart + m_older.size();
+
+			m_newer.clear();
+			for (std::shared_ptr<std::vector<T>>& buffer : m_threadBuffers) {
+				std::move(buffer->begin(), buffer->end(), std::back_inserter(m_newer));
+				buffer->clear();
+			}
+		}
+
+		// Number of readable events the reader has not seen yet
+		size_t Unread(const EventReader<T>& reader) const {
+			return m_newerStart + m_newer.size() - std::max(reader.m_cursor, m_olderStart);
+		}
+
+		/*
+		*  Calls func(const T&) on every readable event the reader has not
+		*  seen yet, oldest first, then marks them as read. Events dropped
+		*  before the reader got to them are skipped.
+		*/
+		template <typename Func>
+		void Read(EventReader<T>& reader, Func&& func) const {
+			size_t cursor = std::max(reader.m_cursor, m_olderStart);
+
+			for (size_t i = cursor - m_olderStart; i < m_older.size(); i++)
+				func(m_older[i]);
+
+			for (size_t i = std::max(cursor, m_newerStart) - m_newerStart; i < m_newer.size(); i++)
+				func(m_newer[i]);
+
+			reader.m_cursor = m_newerStart + m_newer.size();
+		}
+	};
+
+	/*
+	*  Contiguous range of new entities, returned by ECS::CreateEntities().
+	*  Iterates like a container of EntityID, with forward iterators:
+	* 
+	*  std::vector<EntityID> ids(wave.begin(), wave.end());
+	*/
+	class EntityRange {
+	private:
+		EntityID m_first = NULL_ENTITY;
+		size_t m_count = 0;
+
+	public:
+
+		class Iterator {
+		private:
+			EntityID m_id;
+
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = EntityID;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const EntityID*;
+			using reference = EntityID; // IDs are computed, not stored
+
+			Iterator() : m_id(NULL_ENTITY) {}
+
+			explicit Iterator(EntityID id) : m_id(id) {}
+
+			EntityID operator*() const {
+				return m_id;
+			}
+
+			// Entities of a range share their generation, so IDs are consecutive
+			Iterator& operator++() {
+				m_id++;
+				return *this;
+			}
+
+			Iterator operator++(int) {
+				Iterator previous = *this;
+				m_id++;
+				return previous;
+			}
+
+			bool operator==(const Iterator& other) const {
+				return m_id == other.m_id;
+			}
+
+			bool operator!=(const Iterator& other) const {
+				return m_id != other.m_id;
+			}
+		};
+
+		EntityRange() = default;
+
+		EntityRange(EntityID first, size_t count)
+			: m_first(first), m_count(count)
+		{
+		}
+
+		EntityID First() const {
+			return m_first;
+		}
+
+		size_t Size() const {
+			return m_count;
+		}
+
+		EntityID operator[](size_t i) const {
+			return m_first + i;
+		}
+
+		Iterator begin() const {
+			return Iterator(m_first);
+		}
+
+		Iterator end() const {
+			return Iterator(m_first + m_count);
+		}
+	};
+
+
+	class ECS {
+	private:
+
+		// List of IDs already created, but no longer in use.
+		// Stored with their generation already bumped, ready to hand out.
+		std::vector<EntityID> m_availableEntities;
+
+
+		// Current generation of every entity index handed out so far
+		std::vector<EntityGeneration> m_entityGenerations;
+
+
+		// Components owned by each entity index, SIGNATURE_WORDS words per
+		// entity laid out contiguously. Kept up to date by Add()/Remove() so
+		// DeleteEntity() only visits pools holding the entity, and scanned
+		// by FindEntities().
+		std::vector<uint64_t> m_entitySignatures;
+
+
+		// Associates ID with name provided in CreateEntity(), mainly for debugging
+		std::unordered_map<EntityID, std::string> m_entityNames;
+
+
+		// Holds generic pointers to specific component sparse sets.
+		// 
+		// Index into this array using ComponentTypeIndex<T>(), which
+		// is also the bit position of the component in ComponentMask.
+		// Slots of unregistered components are null.
+		std::vector<std::unique_ptr<ISparseSet>> m_componentPools;
+
+		// Plays back recorded commands, needs the requirement depths
+		friend class CommandBuffer;
+
+		// Locks structural changes while systems run
+		friend class Scheduler;
+
+		struct ComponentInfo
+		{
+			bool m_registered = false;
+			// 0 for components without requirements, otherwise one more
+			// than the deepest required component. Adding in increasing
+			// depth order always satisfies requirements.
+			size_t m_requirementDepth = 0;
+
+			// Notified on Add()/Remove() of this component
+			std::vector<IComponentListener*> m_listeners;
+
+			// Group that owns the order of this pool, if any
+			IComponentListener* m_owningGroup = nullptr;
+
+			// Created on first OnConstruct()/OnDestroy()/OnUpdate() and Observe()
+			ComponentSignals* m_signals = nullptr;
+			ComponentEvents* m_events = nullptr;
+
+			// SiblingLinks with this pool as primary, indexed by the type
+			// index of the sibling. Empty until the first LinkSiblings().
+			std::vector<IDenseIndexListener*> m_siblingLinks;
+			ComponentMask m_requiredComponents{};
+			ComponentMask m_isRequiredInComponents{};
+		};
+
+		// Indexed the same way as m_componentPools
+		std::vector<ComponentInfo> m_componentInfos;
+
+
+		// Owning groups created through Group()
+		std::vector<std::unique_ptr<IComponentListener>> m_groups;
+
+
+		// Cached queries created through Query()
+		std::vector<std::unique_ptr<IComponentListener>> m_queries;
+
+
+		// Indexed by EventTypeIndex<T>(), created on first Events<T>()
+		std::vector<std::unique_ptr<IEventChannel>> m_eventChannels;
+
+
+		// Signals and event batches of every component type
+		std::vector<std::unique_ptr<IComponentListener>> m_observers;
+
+
+		// Links created through LinkSiblings(), declared after the pools
+		// so they are destroyed first
+		std::vector<std::unique_ptr<IDenseIndexListener>> m_siblingLinks;
+
+
+		// Highest recorded entity index
+		EntityIndex m_maxEntityID = 0;
+
+
+		// Runs ParallelForEach(), created on first use
+		std::unique_ptr<ThreadPool> m_threadPool;
+
+
+		// Change detection clock, stamped by pools tracking changes
+		std::atomic<Tick> m_changeTick{ 1 };
+
+
+		// Default tick of Changed/Added terms for views made on this
+		// thread, set while a Scheduler system runs
+		static inline thread_local Tick s_systemLastRunTick = 0;
+
+
+		// Non zero while structural changes are forbidden, during
+		// ParallelForEach() and Scheduler::Run(). Atomic since systems
+		// running concurrently may each call ParallelForEach().
+		std::atomic<uint32_t> m_structuralLocks{ 0 };
+
+
+		static constexpr size_t tombstone = std::numeric_limits<size_t>::max();
+
+
+		#define ENTITY_INFO(id) \
+			"['" << GetEntityName(id) << "', ID: " << id << "]"
+
+		#define BSEECS_ASSERT_UNLOCKED() \
+			BSEECS_ASSERT(m_structuralLocks == 0, \
+				"Structural changes are not allowed during ParallelForEach(), record them in a CommandBuffer");
+
+		#define BSEECS_ASSERT_VALID_ENTITY(id) \
+			BSEECS_ASSERT(id != NULL_ENTITY, "NULL_ENTITY cannot be operated on by the ECS") \
+			BSEECS_ASSERT(GetEntityIndex(id) < m_maxEntityID, "Invalid entity ID out of bounds: " << id);
+
+		#define BSEECS_ASSERT_ALIVE_ENTITY(id) \
+			BSEECS_ASSERT(IsAlive(id), "Stale entity ID, entity was already deleted: " << id);
+
+	
+	private:
+
+		template <typename T>
+		size_t GetComponentBitPosition() {
+			size_t index = ComponentTypeIndex<T>();
+			if (index >= MAX_COMPONENTS || !m_componentInfos[index].m_registered)
+				return tombstone;
+
+			return index;
+		}
+
+		template <typename T>
+		ComponentMask* const GetRequiredComponent()
+		{
+			size_t bitPos = GetComponentBitPosition<T>();
+			if (bitPos == tombstone)
+				return nullptr;
+
+			return &m_componentInfos[bitPos].m_requiredComponents;
+		}
+
+		template <typename T>
+		ComponentMask* const GetSustainedComponent()
+		{
+			size_t bitPos = GetComponentBitPosition<T>();
+			if (bitPos == tombstone)
+				return nullptr;
+
+			return &m_componentInfos[bitPos].m_isRequiredInComponents;
+		}
+
+
+		template <typename Component>
+		void SetComponentBit(ComponentMask& mask, bool val) {
+			size_t bitPos = GetComponentBitPosition<Component>();
+			BSEECS_ASSERT(bitPos != tombstone,
+				"Attempting to operate on unregistered component '" << typeid(Component).name() << "'");
+
+			mask[bitPos] = val;
+		}
+
+		template <typename Component>
+		ComponentMask::reference GetComponentBit(ComponentMask& mask) {
+			size_t bitPos = GetComponentBitPosition<Component>();
+			BSEECS_ASSERT(bitPos != tombstone,
+				"Attempting to operate on unregistered component '" << typeid(Component).name() << "'");
+
+			return mask[bitPos];
+		}
+
+		/*
+		*  Assembles a generic mask for the given components
+		*/
+		template <typename... Components>
+		ComponentMask GetMask() {
+			ComponentMask mask;
+			(SetComponentBit<Components>(mask, 1), ...); // fold expression
+			return mask;
+		}
+
+		// Looks up the pools of every term of a view, tag dispatched on the view type
+		template <typename... Components, typename... Excludes, typename... Optionals, typename Filters>
+		BasicView<std::tuple<Components...>, std::tuple<Excludes...>, std::tuple<Optionals...>, Filters>
+			MakeView(BasicView<std::tuple<Components...>, std::tuple<Excludes...>, std::tuple<Optionals...>, Filters>*)
+		{
+			return {
+				{ &GetComponentPool<std::remove_const_t<Components>>()... },
+				{ &GetComponentPool<std::remove_const_t<Excludes>>()... },
+				{ &GetComponentPool<std::remove_const_t<Optionals>>()... },
+				s_systemLastRunTick
+			};
+		}
+
+		template <typename T>
+		ComponentSignals& GetSignals() {
+			GetComponentPool<T>(); // Asserts T is registered
+
+			ComponentInfo& info = m_componentInfos[ComponentTypeIndex<T>()];
+			if (!info.m_signals) {
+				auto signals = std::make_unique<ComponentSignals>();
+				info.m_signals = signals.get();
+				info.m_listeners.push_back(signals.get());
+				m_observers.push_back(std::move(signals));
+			}
+
+			return *info.m_signals;
+		}
+
+		template <typename T, typename... RequiredComponents, typename Func>
+		void AddBulkImpl(const EntityRange& range, Func&& valueAt) {
+			BSEECS_ASSERT_UNLOCKED();
+			if (range.Size() == 0)
+				return;
+
+			BSEECS_ASSERT_VALID_ENTITY(range[range.Size() - 1]);
+
+			SparseSet<T>& pool = GetComponentPool<T>(true);
+
+			ComponentMask incomingCompMask = GetMask<RequiredComponents...>();
+			ComponentMask requiredCompMask = *GetRequiredComponent<T>();
+			BSEECS_ASSERT((incomingCompMask ^ requiredCompMask).none(),
+				typeid(T).name() << " required components mismatch");
+
+			// Per entity checks only test signature bits
+			std::array<uint64_t, SIGNATURE_WORDS> required = GetSignatureMask(static_cast<std::tuple<RequiredComponents...>*>(nullptr));
+			size_t bitPos = ComponentTypeIndex<T>();
+			for (EntityID id : range) {
+				BSEECS_ASSERT_ALIVE_ENTITY(id);
+				const uint64_t* signature = &m_entitySignatures[size_t(GetEntityIndex(id)) * SIGNATURE_WORDS];
+				BSEECS_ASSERT(!(signature[bitPos / 64] & (uint64_t(1) << (bitPos % 64))),
+					ENTITY_INFO(id) << " already has component '" << typeid(T).name() << "' added");
+
+				for (size_t word = 0; word < SIGNATURE_WORDS; word++) {
+					BSEECS_ASSERT((signature[word] & required[word]) == required[word],
+						ENTITY_INFO(id) << " is missing some required components ");
+				}
+			}
+
+			pool.AppendRange(range.First(), range.Size(), valueAt);
+
+			for (EntityID id : range)
+				SetSignatureBit<T>(id, true);
+
+			if (!m_componentInfos[bitPos].m_listeners.empty()) {
+				for (EntityID id : range)
+					NotifyAdd<T>(id);
+			}
+
+			BSEECS_INFO("Attached '" << typeid(T).name() << "' to " << range.Size() << " entities");
+		}
+
+		template <typename Ids>
+		void DestroyBulkImpl(const Ids& ids, size_t count) {
+			BSEECS_ASSERT_UNLOCKED();
+
+			// Entities to remove from each pool
+			std::vector<std::vector<EntityID>> poolDeletions(MAX_COMPONENTS);
+			std::vector<EntityIndex> freedIndices;
+			freedIndices.reserve(count);
+
+			for (EntityID id : ids) {
+				BSEECS_ASSERT_VALID_ENTITY(id);
+				BSEECS_ASSERT_ALIVE_ENTITY(id);
+
+				EntityIndex index = GetEntityIndex(id);
+				uint64_t* signature = &m_entitySignatures[size_t(index) * SIGNATURE_WORDS];
+				for (size_t word = 0; word < SIGNATURE_WORDS; word++) {
+					for (; signature[word] != 0; signature[word] &= signature[word] - 1) {
+						size_t bitPos = word * 64 + internal::CountTrailingZeros(signature[word]);
+
+						Notify(bitPos, &IComponentListener::OnRemove, id);
+
+						poolDeletions[bitPos].push_back(id);
+					}
+				}
+
+				// Bumped right away, so an ID given twice fails the alive check
+				++m_entityGenerations[index];
+
+				m_entityNames.erase(id);
+				freedIndices.push_back(index);
+			}
+
+			for (size_t bitPos = 0; bitPos < MAX_COMPONENTS; bitPos++) {
+				if (!poolDeletions[bitPos].empty())
+					m_componentPools[bitPos]->DeleteBulk(poolDeletions[bitPos]);
+			}
+
+			// Popped from the back, so the lowest index comes out first
+			std::sort(freedIndices.begin(), freedIndices.end(), std::greater<EntityIndex>());
+			for (EntityIndex index : freedIndices)
+				m_availableEntities.push_back(MakeEntityID(index, m_entityGenerations[index]));
+
+			BSEECS_INFO("Deleted " << count << " entities");
+		}
+
+		template <typename T>
+		void SetSignatureBit(EntityID id, bool val) {
+			size_t bitPos = ComponentTypeIndex<T>();
+			uint64_t& word = m_entitySignatures[size_t(GetEntityIndex(id)) * SIGNATURE_WORDS + bitPos / 64];
+			uint64_t bit = uint64_t(1) << (bitPos % 64);
+			word = val ? (word | bit) : (word & ~bit);
+		}
+
+		// Signature words with a bit set for every component of the tuple
+		template <typename... Components>
+		std::array<uint64_t, SIGNATURE_WORDS> GetSignatureMask(std::tuple<Components...>*) {
+			std::array<uint64_t, SIGNATURE_WORDS> mask{};
+			([&]() {
+				size_t bitPos = GetComponentBitPosition<std::remove_const_t<Components>>();
+				BSEECS_ASSERT(bitPos != tombstone,
+					"Attempting to operate on unregistered component '" << typeid(Components).name() << "'");
+
+				mask[bitPos / 64] |= uint64_t(1) << (bitPos % 64);
+			}(), ...);
+
+			return mask;
+		}
+
+		// By index over the listeners present when dispatch starts, since a
+		// listener may connect others, e.g. OnConstruct<T>() from a signal
+		void Notify(size_t bitPos, void (IComponentListener::*event)(EntityID), EntityID id) {
+			std::vector<IComponentListener*>& listeners = m_componentInfos[bitPos].m_listeners;
+			for (size_t i = 0, count = listeners.size(); i < count; i++)
+				(listeners[i]->*event)(id);
+		}
+
+		template <typename T>
+		void NotifyAdd(EntityID id) {
+			Notify(ComponentTypeIndex<T>(), &IComponentListener::OnAdd, id);
+		}
+
+		template <typename T>
+		void NotifyRemove(EntityID id) {
+			Notify(ComponentTypeIndex<T>(), &IComponentListener::OnRemove, id);
+		}
+
+		template <typename T>
+		void NotifyUpdate(EntityID id) {
+			Notify(ComponentTypeIndex<T>(), &IComponentListener::OnUpdate, id);
+		}
+
+		template <typename DependentComponent, typename RequiredComponent>
+		void SetRequirements()
+		{
+			ComponentMask& requiredCompMask = *GetSustainedComponent<RequiredComponent>();
+			SetComponentBit<DependentComponent>(requiredCompMask, 1);
+		}
+
+		/*
+		*  Broadcast to the components that I depends on, the requirement
+		* To make it easy when removing it
+		*/
+		template <typename DependentComponent, typename... RequiredComponents>
+		void BroadcastRequirements()
+		{
+			// Get the bit position of the component
+			(SetRequirements<DependentComponent, RequiredComponents>(), ...); // fold expression
+		}
+
+	public:
+
+		ECS()
+			: m_componentPools(MAX_COMPONENTS), m_componentInfos(MAX_COMPONENTS)
+		{
+		}
+
+		/*
+		* Retrieves reference for the specific component pool given a component name
+		*/
+		template <typename T>
+		SparseSet<T>& GetComponentPool(bool registerIfNotFound = false)
+		{
+			size_t bitPos = GetComponentBitPosition<T>();
+
+			if (bitPos == tombstone)
+			{
 				if (registerIfNotFound)
 				{
 					RegisterComponent<T>();
 					bitPos = GetComponentBitPosition<T>();
 				}
-				BSEECS_ASSERT(registerIfNotFound,
-					"Attempting to operate on unregistered component '" << typeid(T).name() << "'");
-			}
+				BSEECS_ASSERT(registerIfNotFound,
+					"Attempting to operate on unregistered component '" << typeid(T).name() << "'");
+			}
+
+			BSEECS_ASSERT(bitPos < m_componentPools.size() && bitPos >= 0,
+				"(Internal): Attempting to index into m_componentPools with out of range bit position");
+
+			// The slot is owned by T's type index, so the pool
+			// stored there is always a SparseSet<T>
+			ISparseSet* genericPtr = m_componentPools[bitPos].get();
+			return *static_cast<SparseSet<T>*>(genericPtr);
+		}
+
+
+		/*
+		*  Creates an entity and returns the ID to refer to that entity.
+		* 
+		*  @param(name): 
+		*  * Optional and used for debugging purposes, it
+		*    shouldn't be used often since there's no optimization 
+		*    in place yet for entities that share a name.
+		*/
+		EntityID CreateEntity(std::string_view name="") {
+			BSEECS_ASSERT_UNLOCKED();
+			EntityID id = tombstone;
+
+			if (m_availableEntities.size() == 0) {
+				BSEECS_ASSERT(m_maxEntityID < MAX_ENTITIES, "Entity limit exceeded");
+				id = MakeEntityID(m_maxEntityID++, 0);
+				m_entityGenerations.push_back(0);
+				m_entitySignatures.resize(m_entitySignatures.size() + SIGNATURE_WORDS, 0);
+			}
+			else {
+				id = m_availableEntities.back();
+				m_availableEntities.pop_back();
+			}
+
+			BSEECS_ASSERT(id != tombstone, "Cannot create entity with null ID");
+
+			if (!name.empty())
+				m_entityNames[id] = name;
+
+			BSEECS_INFO("Created entity " << ENTITY_INFO(id));
+			return id;
+		}
+
+		/*
+		*  Creates 'count' entities with consecutive IDs in one step.
+		* 
+		*  The indices are always fresh ones, IDs freed by DeleteEntity()
+		*  are left for CreateEntity(). Entities are unnamed.
+		*/
+		EntityRange CreateEntities(size_t count) {
+			BSEECS_ASSERT_UNLOCKED();
+			BSEECS_ASSERT(m_maxEntityID + count <= MAX_ENTITIES, "Entity limit exceeded");
+
+			EntityIndex first = m_maxEntityID;
+			m_maxEntityID += static_cast<EntityIndex>(count);
+
+			// Fresh indices all start at generation 0
+			m_entityGenerations.resize(m_maxEntityID, 0);
+			m_entitySignatures.resize(size_t(m_maxEntityID) * SIGNATURE_WORDS, 0);
+
+			BSEECS_INFO("Created " << count << " entities starting at ID " << first);
+			return EntityRange(MakeEntityID(first, 0), count);
+		}
+
+		/*
+		*  Returns true if the ID refers to an entity that has not been deleted,
+		*  false for stale handles whose index has since been recycled.
+		*/
+		bool IsAlive(EntityID id) const {
+			EntityIndex index = GetEntityIndex(id);
+			return index < m_entityGenerations.size()
+				&& m_entityGenerations[index] == GetEntityGeneration(id);
+		}
+
+		std::string GetEntityName(EntityID id) {
+			BSEECS_ASSERT_VALID_ENTITY(id);
+
+			auto it = m_entityNames.find(id);
+			if (it == m_entityNames.end())
+				return "Entity";
+
+			return it->second;
+		}
+
+		/*
+		* Deletes an active entity and its associated components.
+		* - Overwrites the given entity to NULL_ENTITY.
+		* - Only the pools recorded in the entity signature are touched,
+		*   required/sustained component rules are not checked.
+		* 
+		* This should NOT be used in the middle of a system while iterating
+		* through entities, as it will remove from the list immediately. Record
+		* the deletion in a CommandBuffer instead, and play it back once
+		* iteration is over.
+		*/
+		void DeleteEntity(EntityID& id) {
+			BSEECS_ASSERT_UNLOCKED();
+			BSEECS_ASSERT_VALID_ENTITY(id);
+			BSEECS_ASSERT_ALIVE_ENTITY(id);
+			
+			std::string name = GetEntityName(id);
+
+			EntityIndex index = GetEntityIndex(id);
+			uint64_t* signature = &m_entitySignatures[size_t(index) * SIGNATURE_WORDS];
+			for (size_t word = 0; word < SIGNATURE_WORDS; word++) {
+				for (; signature[word] != 0; signature[word] &= signature[word] - 1) {
+					size_t bitPos = word * 64 + internal::CountTrailingZeros(signature[word]);
+
+					Notify(bitPos, &IComponentListener::OnRemove, id);
+
+					m_componentPools[bitPos]->Delete(id);
+				}
+			}
+
+			// Invalidates every handle to this entity still held elsewhere
+			EntityGeneration generation = ++m_entityGenerations[index];
+
+			m_entityNames.erase(id);
+			m_availableEntities.push_back(MakeEntityID(index, generation));
+
+			BSEECS_INFO("Deleted entity ['" << name << "', ID: " << id << "]");
+			id = NULL_ENTITY;
+		}
+
+		/*
+		*  Deletes several entities at once, same rules as DeleteEntity().
+		* 
+		*  Removals are grouped per pool and each pool is compacted in a
+		*  single pass. The freed IDs are handed out again by CreateEntity()
+		*  in increasing index order.
+		*/
+		void DestroyBulk(Span<const EntityID> ids) {
+			DestroyBulkImpl(ids, ids.size());
+		}
+
+		/*
+		*  Same as above for the entities of a range, e.g. a wave spawned
+		*  by CreateEntities()
+		*/
+		void DestroyBulk(const EntityRange& range) {
+			DestroyBulkImpl(range, range.Size());
+		}
+
+		/*
+		*  Deletes every entity, keeping registered components, groups and
+		*  cached queries. Pools keep their storage allocated for reuse.
+		* 
+		*  Listeners get a single OnClear() call rather than OnRemove()
+		*  for each entity. Every ID handed out so far becomes stale, and
+		*  CreateEntity() starts again from index 0.
+		*/
+		void Clear() {
+			BSEECS_ASSERT_UNLOCKED();
+
+			for (std::unique_ptr<ISparseSet>& pool : m_componentPools) {
+				if (pool)
+					pool->Clear();
+			}
+
+			// A listener can be registered to several components
+			std::vector<IComponentListener*> listeners;
+			for (ComponentInfo& info : m_componentInfos) {
+				for (IComponentListener* listener : info.m_listeners) {
+					if (std::find(listeners.begin(), listeners.end(), listener) == listeners.end())
+						listeners.push_back(listener);
+				}
+			}
+
+			for (IComponentListener* listener : listeners)
+				listener->OnClear();
+
+			std::fill(m_entitySignatures.begin(), m_entitySignatures.end(), 0);
+			m_entityNames.clear();
+
+			m_availableEntities.clear();
+			m_availableEntities.reserve(m_maxEntityID);
+			for (EntityIndex index = m_maxEntityID; index > 0; index--) {
+				EntityGeneration generation = ++m_entityGenerations[index - 1];
+				m_availableEntities.push_back(MakeEntityID(index - 1, generation));
+			}
+
+			BSEECS_INFO("Cleared all entities");
+		}
+
+		/*
+		*  Register a component with specific required components 
+		*	and create a pool for it
+		*/
+		template <typename T, typename ...Components>
+		void RegisterComponent() {
+			BSEECS_ASSERT_UNLOCKED();
+			const char* name = typeid(T).name();
+			size_t index = ComponentTypeIndex<T>();
+			BSEECS_ASSERT(index < MAX_COMPONENTS,
+				"Exceeded max number of component types, '" << name << "' cannot be registered");
+			BSEECS_ASSERT(!m_componentInfos[index].m_registered,
+				"Component with name '" << name << "' already registered");
+
+			ComponentMask requiredCompMask = GetMask<Components...>();
+
+			size_t depth = 0;
+			((depth = std::max(depth, m_componentInfos[ComponentTypeIndex<Components>()].m_requirementDepth + 1)), ...);
+
+			ComponentInfo& current = m_componentInfos[index];
+			current.m_registered = true;
+			current.m_requirementDepth = depth;
+			current.m_requiredComponents = requiredCompMask;
+			current.m_isRequiredInComponents = ComponentMask();
+
+			m_componentPools[index] = std::make_unique<SparseSet<T>>();
+			if constexpr (SparseSet<T>::TracksChanges)
+				static_cast<SparseSet<T>*>(m_componentPools[index].get())->SetTickSource(&m_changeTick);
+
+			// Hello I require you, so beware when you be removed
+			BroadcastRequirements<T, Components...>();
+
+			BSEECS_INFO("Registered component '" << name << "'");
+		}
+
+		/*
+		*  Attaches a component to an entity
+		* 
+		* - AddComponent<Transform>(player, {x, y, z});
+		* 
+		*  The returned reference is invalidated by the next Add<T>() unless
+		*  ComponentTraits<T>::Storage is a PagedStorage. Even then it is
+		*  invalidated by removing any T, by a group owning T packing its
+		*  entities and by Sort<T>() or SortAs<T, Other>(), see PagedStorage.
+		*/
+		template <typename T, typename... RequiredComponents>
+		typename SparseSet<T>::Reference Add(EntityID id, T&& component={}) {
+			return Emplace<T, RequiredComponents...>(id, std::move(component));
+		}
+
+		/*
+		*  Same as Add(), constructing the component in place from the
+		*  given arguments. Works for move-only components.
+		* 
+		* - ecs.Emplace<Mesh, Transform>(player, std::move(vertices), material);
+		*/
+		template <typename T, typename... RequiredComponents, typename... Args>
+		typename SparseSet<T>::Reference Emplace(EntityID id, Args&&... args) {
+			BSEECS_ASSERT_UNLOCKED();
+			BSEECS_ASSERT_VALID_ENTITY(id);
+			BSEECS_ASSERT_ALIVE_ENTITY(id);
+
+			// Do this first so component pool gets registered before Has<T>()
+			SparseSet<T>& pool = GetComponentPool<T>(true);
+
+			BSEECS_ASSERT(!pool.Contains(id),
+				ENTITY_INFO(id) << " already has component '" << typeid(T).name() << "' added");
+
+
+			ComponentMask incomingCompMask = GetMask<RequiredComponents...>();
+			ComponentMask requiredCompMask = *GetRequiredComponent<T>();
+			ComponentMask resultDiff = incomingCompMask ^ requiredCompMask;
+			BSEECS_ASSERT(resultDiff.none(),
+				typeid(T).name() << " required components mismatch");
+
+			// What about checking and then add if not present
+			bool requiredSatisfied = HasAllRequired<RequiredComponents...>(id);
+			BSEECS_ASSERT(requiredSatisfied,
+				ENTITY_INFO(id) << " is missing some required components ");
+
+			SetSignatureBit<T>(id, true);
+			pool.Emplace(id, std::forward<Args>(args)...);
+
+			NotifyAdd<T>(id);
+
+			BSEECS_INFO("Attached '" << typeid(T).name() << "' to " << ENTITY_INFO(id));
+			return pool.GetRef(id); // Listeners may have moved it
+		}
+
+		/*
+		*  Attaches a component to every entity of a range, values[i] going
+		*  to the i-th entity. Same rules as Add(), but the requirements are
+		*  validated once and the pool storage is reserved once.
+		* 
+		* - ecs.AddBulk<Velocity, Transform>(projectiles, velocities);
+		*/
+		template <typename T, typename... RequiredComponents>
+		void AddBulk(const EntityRange& range, const std::vector<T>& values) {
+			BSEECS_ASSERT(values.size() == range.Size(),
+				"AddBulk() given " << values.size() << " values for " << range.Size() << " entities");
+
+			AddBulkImpl<T, RequiredComponents...>(range, [&values](size_t i) -> const T& { return values[i]; });
+		}
+
+		/*
+		*  Same as above, with every entity getting a copy of the same value
+		*/
+		template <typename T, typename... RequiredComponents>
+		void AddBulk(const EntityRange& range, const T& value = {}) {
+			AddBulkImpl<T, RequiredComponents...>(range, [&value](size_t) -> const T& { return value; });
+		}
+
+		/*
+		*  Retrieves the specified component for the given entity
+		* 
+		* - ecs.GetComponent<Transform>(player);
+		*/
+		template <typename T>
+		typename SparseSet<T>::Reference Get(EntityID id) {
+			BSEECS_ASSERT_VALID_ENTITY(id);
+			BSEECS_ASSERT_ALIVE_ENTITY(id);
+
+			SparseSet<T>& pool = GetComponentPool<T>();
+			BSEECS_ASSERT(pool.Contains(id),
+				ENTITY_INFO(id) << " missing component 'in " << typeid(T).name() << "' pool");
+
+			pool.MarkChanged(id);
+			return pool.GetRef(id);
+		}
+
+		/*
+		*  Stamps the component of the entity as changed, for writes that
+		*  did not go through Get() or a mutable ForEach()/View().
+		*/
+		template <typename T>
+		void MarkChanged(EntityID id) {
+			BSEECS_ASSERT_VALID_ENTITY(id);
+			BSEECS_ASSERT_ALIVE_ENTITY(id);
+
+			SparseSet<T>& pool = GetComponentPool<T>();
+			BSEECS_ASSERT(pool.Contains(id),
+				ENTITY_INFO(id) << " missing component 'in " << typeid(T).name() << "' pool");
+
+			pool.MarkChanged(id);
+			NotifyUpdate<T>(id);
+		}
+
+		/*
+		*  Modifies a component through the given function, then stamps it
+		*  as changed and fires the update signals.
+		* 
+		* - ecs.Patch<Transform>(player, [](Transform& t) { t.x += 1.0f; });
+		* 
+		*  The function gets a SparseSet<T>::Reference, which is T& unless
+		*  T uses SoAStorage.
+		*/
+		template <typename T, typename Func>
+		typename SparseSet<T>::Reference Patch(EntityID id, Func&& func) {
+			BSEECS_ASSERT_VALID_ENTITY(id);
+			BSEECS_ASSERT_ALIVE_ENTITY(id);
+
+			SparseSet<T>& pool = GetComponentPool<T>();
+			BSEECS_ASSERT(pool.Contains(id),
+				ENTITY_INFO(id) << " missing component 'in " << typeid(T).name() << "' pool");
+
+			typename SparseSet<T>::Reference component = pool.GetRef(id);
+			func(component);
+
+			pool.MarkChanged(id);
+			NotifyUpdate<T>(id);
+			return component;
+		}
+
+		/*
+		*  Returns the event channel of type T, created on first call.
+		*  Create the channels used by systems before running them.
+		* 
+		*  ecs.Events<Collision>().Send({ a, b });
+		*  ...
+		*  ecs.UpdateEvents(); // once per frame
+		*  ...
+		*  ecs.Events<Collision>().Read(reader, [](const Collision& c) { ... });
+		*/
+		template <typename T>
+		EventChannel<T>& Events() {
+			size_t index = EventTypeIndex<T>();
+			if (index >= m_eventChannels.size() || !m_eventChannels[index]) {
+				BSEECS_ASSERT_UNLOCKED();
+				if (index >= m_eventChannels.size())
+					m_eventChannels.resize(index + 1);
+				m_eventChannels[index] = std::make_unique<EventChannel<T>>();
+			}
+
+			// The slot is owned by T's event type index
+			return *static_cast<EventChannel<T>*>(m_eventChannels[index].get());
+		}
+
+		/*
+		*  Makes the events sent since the last call readable in every
+		*  channel, see EventChannel::Update(). Must not run while events
+		*  are sent or read.
+		*/
+		void UpdateEvents() {
+			BSEECS_ASSERT_UNLOCKED();
+			for (std::unique_ptr<IEventChannel>& channel : m_eventChannels) {
+				if (channel)
+					channel->Update();
+			}
+		}
+
+		/*
+		*  Connects a callback run with the entity ID after a T is attached
+		*  to it, by Add(), Emplace() or AddBulk().
+		* 
+		*  Callbacks run synchronously, one std::function call per event;
+		*  prefer Observe() to process many events in bulk.
+		*/
+		template <typename T>
+		void OnConstruct(ComponentSignals::Callback callback) {
+			GetSignals<T>().ConnectConstruct(std::move(callback));
+		}
+
+		/*
+		*  Connects a callback run before a T is detached from an entity,
+		*  by Remove(), DeleteEntity() or DestroyBulk(), while it can still
+		*  be accessed. ECS::Clear() does not run it.
+		*/
+		template <typename T>
+		void OnDestroy(ComponentSignals::Callback callback) {
+			GetSignals<T>().ConnectDestroy(std::move(callback));
+		}
+
+		// Connects a callback run after Patch<T>() and MarkChanged<T>()
+		template <typename T>
+		void OnUpdate(ComponentSignals::Callback callback) {
+			GetSignals<T>().ConnectUpdate(std::move(callback));
+		}
+
+		/*
+		*  Returns the event batch of a component type, created on first
+		*  call. From then on, every addition, removal and update of a T
+		*  appends the entity ID to the matching array, until Clear().
+		* 
+		*  ComponentEvents& moved = ecs.Observe<Transform>();
+		*  ...
+		*  grid.Reinsert(moved.Updated());
+		*  moved.Clear();
+		* 
+		*  Updates go through Patch()/MarkChanged(), which must not be
+		*  called from several threads at once on an observed component.
+		*/
+		template <typename T>
+		ComponentEvents& Observe() {
+			GetComponentPool<T>(); // Asserts T is registered
+
+			ComponentInfo& info = m_componentInfos[ComponentTypeIndex<T>()];
+			if (!info.m_events) {
+				auto events = std::make_unique<ComponentEvents>();
+				info.m_events = events.get();
+				info.m_listeners.push_back(events.get());
+				m_observers.push_back(std::move(events));
+			}
+
+			return *info.m_events;
+		}
+
+		// Current tick of the change detection clock
+		Tick ChangeTick() const {
+			return m_changeTick.load(std::memory_order_relaxed);
+		}
+
+		/*
+		*  Moves the change detection clock forward and returns the new tick.
+		*  Writes made afterwards are stamped with it, so the tick before it
+		*  picks them up later on:
+		* 
+		*  Tick last = ecs.AdvanceTick() - 1;
+		*  ...
+		*  ecs.View<Changed<Transform>>().Since(last).Each(...);
+		*/
+		Tick AdvanceTick() {
+			return m_changeTick.fetch_add(1, std::memory_order_relaxed) + 1;
+		}
+
+		/*
+		*  Removes a component from an entity
+		* 
+		* - ecs.RemoveComponent<Transform>(player);
+		*/
+		template <typename T, typename... SustainedComponents>
+		void Remove(EntityID id) {
+			BSEECS_ASSERT_UNLOCKED();
+			BSEECS_ASSERT_VALID_ENTITY(id);
+			BSEECS_ASSERT_ALIVE_ENTITY(id);
+
+			SparseSet<T>& pool = GetComponentPool<T>();
+			BSEECS_ASSERT(pool.Contains(id),
+				ENTITY_INFO(id) << " has no component '" << typeid(T).name() << "' to remove");
+
+			ComponentMask incomingCompMask = GetMask<SustainedComponents...>();
+			ComponentMask sustainedCompMask = *GetSustainedComponent<T>();
+			ComponentMask resultDiff = incomingCompMask ^ sustainedCompMask;
+			BSEECS_ASSERT(resultDiff.none(),
+				typeid(T).name() << " sustained components mismatch");
+
+			// What about checking and then add if not present
+			bool allSustainedRemoved = HasRemovedAll<SustainedComponents...>(id);
+			BSEECS_ASSERT(allSustainedRemoved,
+				ENTITY_INFO(id) << " Delete first all sustained components ");
+
+			NotifyRemove<T>(id);
+
+			pool.Delete(id);
+			SetSignatureBit<T>(id, false);
+			BSEECS_INFO("Removed '" << typeid(T).name() << "' from " << ENTITY_INFO(id));
+		}
+
+		template <typename T>
+		bool Has(EntityID id) {
+			if (!IsAlive(id))
+				return false;
+
+			// The signature is the entity's presence bitset across all pools
+			size_t bitPos = GetComponentBitPosition<T>();
+			BSEECS_ASSERT(bitPos != tombstone,
+				"Attempting to operate on unregistered component '" << typeid(T).name() << "'");
+
+			const uint64_t* signature = &m_entitySignatures[size_t(GetEntityIndex(id)) * SIGNATURE_WORDS];
+			return (signature[bitPos / 64] >> (bitPos % 64)) & 1;
+		}
+
+		template <typename... Ts>
+		bool HasAll(EntityID id) {
+			// Fold operator, reads as 
+			// (HasComponent<Transform> && HasComponent<Physics> && HasComponent<Sprite> && ...)
+			return (Has<Ts>(id) && ...);
+		}
+
+		template <typename T>
+		bool HasRequired(EntityID id)
+		{
+			SparseSet<T>& pool = GetComponentPool<T>();
+			bool hasId = pool.Contains(id);
+
+			BSEECS_ASSERT(hasId,
+				ENTITY_INFO(id) << " has no REQUIRED component '" << typeid(T).name());
+
+			return hasId;
+		}
+
+		template <typename... Ts>
+		bool HasAllRequired(EntityID id)
+		{
+			// Fold operator, reads as 
+			// (HasRequired<Transform> && HasRequired<Physics> && HasRequired<Sprite> && ...)
+			return (HasRequired<Ts>(id) && ...);
+		}
+
+		template <typename T>
+		bool HasRemoved(EntityID id)
+		{
+			SparseSet<T>& pool = GetComponentPool<T>();
+			bool hasId = pool.Contains(id);
+
+			bool ret = hasId ? false : true;
+
+			BSEECS_ASSERT(ret,
+				ENTITY_INFO(id) << " has to remove component '" << typeid(T).name());
+
+			return ret;
+		}
+
+		template <typename... Ts>
+		bool HasRemovedAll(EntityID id)
+		{
+			// Fold operator, reads as 
+			// (HasRequired<Transform> && HasRequired<Physics> && HasRequired<Sprite> && ...)
+			return (HasRemoved<Ts>(id) && ...);
+		}
+
+		/*
+		*  Returns the T component of the entity owning the element at
+		*  DenseID in the TDense pool. A single load when the two pools are
+		*  linked with LinkSiblings().
+		*/
+		template <typename TDense, typename T>
+		T& GetSibiling(EntityID DenseID)
+		{
+			const std::vector<IDenseIndexListener*>& links = m_componentInfos[ComponentTypeIndex<TDense>()].m_siblingLinks;
+			if (!links.empty() && links[ComponentTypeIndex<T>()]) {
+				// The slot is owned by the pair of types
+				return static_cast<SiblingLinks<TDense, T>*>(links[ComponentTypeIndex<T>()])->Get(DenseID);
+			}
+
+			EntityID EntId = GetComponentPool<TDense>().GetEntity(DenseID);
+			return GetComponentPool<T>().GetRef(EntId);
+		}
+
+		/*
+		*  Returns the links from the Primary pool to the Sibling pool,
+		*  creating them on first call. Meant for pairs of components always
+		*  accessed together, e.g. Transform and RigidBody.
+		* 
+		*  Every element moved in either pool then also patches a link, so
+		*  only link pools that are joined far more often than modified.
+		* 
+		*  auto& links = ecs.LinkSiblings<Transform, RigidBody>();
+		*  RigidBody& body = links.Get(transformDenseIndex);
+		*/
+		template <typename Primary, typename Sibling>
+		SiblingLinks<Primary, Sibling>& LinkSiblings()
+		{
+			using LinksType = SiblingLinks<Primary, Sibling>;
+
+			std::vector<IDenseIndexListener*>& links = m_componentInfos[ComponentTypeIndex<Primary>()].m_siblingLinks;
+			if (!links.empty() && links[ComponentTypeIndex<Sibling>()])
+				return *static_cast<LinksType*>(links[ComponentTypeIndex<Sibling>()]);
+
+			BSEECS_ASSERT_UNLOCKED();
+			auto created = std::make_unique<LinksType>(GetComponentPool<Primary>(), GetComponentPool<Sibling>());
+			LinksType& result = *created;
+
+			links.resize(MAX_COMPONENTS, nullptr);
+			links[ComponentTypeIndex<Sibling>()] = &result;
+
+			m_siblingLinks.push_back(std::move(created));
+			return result;
+		}
+
+		template <typename T>
+		T& GetSibiling(const SparseSet<T>& DensCompPool, EntityID DenseID)
+		{
+			EntityID EntId = DensCompPool.GetEntity(DenseID);
+			return GetComponentPool<T>().GetRef(EntId);
+		}
+
+		/*
+		*  Sorts the pool of T, see SparseSet::Sort(). The pool must not be
+		*  owned by a group, which dictates its order.
+		* 
+		* - ecs.Sort<Sprite>([](const Sprite& lhs, const Sprite& rhs) { return lhs.depth < rhs.depth; });
+		*/
+		template <typename T, typename Compare>
+		void Sort(Compare cmp)
+		{
+			BSEECS_ASSERT_UNLOCKED();
+			SparseSet<T>& pool = GetComponentPool<T>();
+			BSEECS_ASSERT(!m_componentInfos[ComponentTypeIndex<T>()].m_owningGroup,
+				"Component '" << typeid(T).name() << "' is owned by a group and cannot be sorted");
+
+			pool.Sort(std::move(cmp));
+		}
+
+		/*
+		*  Sorts the pool of T in the order of the pool of Other, see
+		*  SparseSet::SortAs(). Only T's pool must not be group owned.
+		* 
+		* - ecs.SortAs<RigidBody, Transform>();
+		*/
+		template <typename T, typename Other>
+		void SortAs()
+		{
+			BSEECS_ASSERT_UNLOCKED();
+			SparseSet<T>& pool = GetComponentPool<T>();
+			BSEECS_ASSERT(!m_componentInfos[ComponentTypeIndex<T>()].m_owningGroup,
+				"Component '" << typeid(T).name() << "' is owned by a group and cannot be sorted");
+
+			pool.SortAs(GetComponentPool<Other>());
+		}
+
+		/*
+		*  Returns a View over the entities having all the given components,
+		*  usable with range-for and structured bindings:
+		* 
+		*  for (auto& [id, a, c] : ecs.View<A, C>()) { ... }
+		*/
+		template <typename... Terms>
+		bseecs::View<Terms...> View()
+		{
+			return MakeView(static_cast<bseecs::View<Terms...>*>(nullptr));
+		}
+
+		/*
+		*  Returns the owning group of the given components, creating it
+		*  on first call. Creation packs the entities already matching.
+		* 
+		*  ecs.Group<Transform, Velocity>().Each([](Transform& t, Velocity& v) { ... });
+		* 
+		*  A component can only be owned by one group. Owned pools keep their
+		*  group order, so they must not be sorted.
+		*/
+		template <typename... Owned>
+		bseecs::Group<Owned...>& Group()
+		{
+			BSEECS_ASSERT_UNLOCKED();
+			using GroupType = bseecs::Group<Owned...>;
+			using Lead = std::tuple_element_t<0, std::tuple<Owned...>>;
+
+			// Also asserts every owned component is registered
+			(GetComponentPool<Owned>(), ...);
+
+			IComponentListener* existing = m_componentInfos[ComponentTypeIndex<Lead>()].m_owningGroup;
+			if (existing) {
+				GroupType* group = dynamic_cast<GroupType*>(existing);
+				BSEECS_ASSERT(group, "Component '" << typeid(Lead).name() << "' already owned by another group");
+				return *group;
+			}
+
+			([&]() {
+				BSEECS_ASSERT(!m_componentInfos[ComponentTypeIndex<Owned>()].m_owningGroup,
+					"Component '" << typeid(Owned).name() << "' already owned by another group");
+			}(), ...);
+
+			auto group = std::make_unique<GroupType>(GetComponentPool<Owned>()...);
+			GroupType& result = *group;
+
+			([&]() {
+				ComponentInfo& info = m_componentInfos[ComponentTypeIndex<Owned>()];
+				info.m_owningGroup = &result;
+				info.m_listeners.push_back(&result);
+			}(), ...);
+
+			m_groups.push_back(std::move(group));
+			return result;
+		}
+
+		/*
+		*  Returns the cached query over the given components, creating it
+		*  on first call. Unlike Group(), it does not reorder the pools, so
+		*  it works on pools owned by a group.
+		* 
+		*  Keep the returned reference around, looking the query up again
+		*  scans every cached query.
+		* 
+		*  ecs.Query<Transform, Collider>().Each([](Transform& t, Collider& c) { ... });
+		*/
+		template <typename... Components>
+		CachedQuery<Components...>& Query()
+		{
+			using QueryType = CachedQuery<Components...>;
+			for (std::unique_ptr<IComponentListener>& query : m_queries) {
+				if (QueryType* existing = dynamic_cast<QueryType*>(query.get()))
+					return *existing;
+			}
+
+			BSEECS_ASSERT_UNLOCKED();
+			auto query = std::make_unique<QueryType>(GetComponentPool<Components>()...);
+			QueryType& result = *query;
+
+			(m_componentInfos[ComponentTypeIndex<Components>()].m_listeners.push_back(&result), ...);
+
+			m_queries.push_back(std::move(query));
+			return result;
+		}
+
+		/*
+		*  Appends to 'out' every entity having all the required components and
+		*  none of the excluded ones, found by scanning the entity signatures
+		*  instead of a pool. Optional<...> terms are ignored, Changed<...> and
+		*  Added<...> filters are rejected since signatures carry no ticks.
+		* 
+		*  Costs the same whatever the pool sizes, so it beats View() when
+		*  no single pool is selective, e.g. large pools with a small overlap.
+		*  Uses AVX2 or SSE4.1 when the build enables them.
+		* 
+		*  ecs.FindEntities<A, B, Exclude<Stunned>>(matches);
+		*/
+		template <typename... Terms>
+		void FindEntities(std::vector<EntityID>& out)
+		{
+			using QueryTerms = internal::QueryTerms<Terms...>;
+			static_assert(std::tuple_size_v<typename QueryTerms::Includes> > 0,
+				"FindEntities() needs at least one required component");
+			static_assert(std::tuple_size_v<typename QueryTerms::Filters> == 0,
+				"FindEntities() does not support Changed<...> or Added<...> filters, use View()");
+
+			std::array<uint64_t, SIGNATURE_WORDS> include = GetSignatureMask(static_cast<typename QueryTerms::Includes*>(nullptr));
+			std::array<uint64_t, SIGNATURE_WORDS> exclude = GetSignatureMask(static_cast<typename QueryTerms::Excludes*>(nullptr));
+
+			size_t first = out.size();
+			internal::FilterSignatures<SIGNATURE_WORDS>(m_entitySignatures.data(), m_maxEntityID,
+				include.data(), exclude.data(), out);
+
+			// Matches are written as indices, dead entities have empty
+			// signatures so every match is alive
+			for (size_t i = first; i < out.size(); i++) {
+				EntityIndex index = static_cast<EntityIndex>(out[i]);
+				out[i] = MakeEntityID(index, m_entityGenerations[index]);
+			}
+		}
+
+		template <typename... Terms>
+		std::vector<EntityID> FindEntities()
+		{
+			std::vector<EntityID> out;
+			FindEntities<Terms...>(out);
+			return out;
+		}
+
+		/*
+		*  Executes a passed lambda on all the entities that match the
+		*  passed parameter pack.
+		*
+		*  Provided function should follow one of two forms:
+		*  [](EntityID id, Component& c1, Component& c2);
+		*  [](Component& c1, Component& c2);
+		*	Entities missing any of the components are skipped, iteration
+		*	is driven by the smallest of the component pools.
+		*	Tag components (empty types) may be left out of the lambda args.
+		* 
+		*  Exclude<...> and Optional<...> terms can be mixed in the pack,
+		*  optional components are passed as pointers after the others:
+		*  ecs.ForEach<A, Exclude<B>, Optional<C>>([](A& a, C* c) { ... });
+		*/
+		template <typename MainComponent, typename ...Components, typename Func>
+		void ForEach(Func&& func)
+		{
+			View<MainComponent, Components...>().Each(std::forward<Func>(func));
+		}
+
+		/*
+		*  Hands the given members of every T to the lambda as contiguous
+		*  spans, one call for the whole pool. Meant for SoAStorage pools,
+		*  the loop over the spans is easy to vectorize:
+		* 
+		*  ecs.ForEachFields<Particle, &Particle::position, &Particle::velocity>(
+		*      [](Span<Vec3> positions, Span<const Vec3> velocities) { ... });
+		* 
+		*  The lambda may also take a Span<const EntityID> first, the
+		*  entity of each element.
+		*/
+		template <typename T, auto... Members, typename Func>
+		void ForEachFields(Func&& func)
+		{
+			SparseSet<T>& pool = GetComponentPool<T>();
+			typename SparseSet<T>::Storage& storage = pool.Data();
+			const std::vector<EntityID>& entities = pool.Entities();
+
+			if constexpr (std::is_invocable_v<Func, Span<const EntityID>, decltype(storage.template Field<Members>())...>)
+				func(Span<const EntityID>(entities.data(), entities.size()), storage.template Field<Members>()...);
+			else
+				func(storage.template Field<Members>()...);
+
+			pool.MarkChangedRange(0, pool.Size());
+		}
+
+		/*
+		*  Hands the components to the lambda as spans over contiguous runs
+		*  of the dense lists, so kernels can be written over whole arrays:
+		* 
+		*  ecs.ForEachChunk<Position, const Velocity>(
+		*      [](Span<const EntityID> ids, Span<Position> p, Span<const Velocity> v) { ... });
+		* 
+		*  A single component is walked over its whole pool, one run per
+		*  page with PagedStorage. Several components need the owning
+		*  Group<Components...>() to exist, its packed prefix is walked.
+		*  The entity span is optional. Tag and SoAStorage components are
+		*  not supported, see ForEachFields() for the latter.
+		*/
+		template <typename... Components, typename Func>
+		void ForEachChunk(Func&& func)
+		{
+			static_assert(sizeof...(Components) > 0, "ForEachChunk needs at least one component");
+			static_assert(!(std::is_empty_v<Components> || ...), "Tag components have no data to iterate");
+
+			using Lead = std::remove_const_t<std::tuple_element_t<0, std::tuple<Components...>>>;
+
+			size_t count = GetComponentPool<Lead>().Size();
+			if constexpr (sizeof...(Components) > 1) {
+				IComponentListener* owner = m_componentInfos[ComponentTypeIndex<Lead>()].m_owningGroup;
+				auto* group = dynamic_cast<bseecs::Group<std::remove_const_t<Components>...>*>(owner);
+				BSEECS_ASSERT(group, "ForEachChunk<...> over several components needs the matching Group<...>()");
+				count = group->Size();
+			}
+
+			const std::vector<EntityID>& entities = GetComponentPool<Lead>().Entities();
+			auto pools = std::make_tuple(&GetComponentPool<std::remove_const_t<Components>>()...);
+			auto storages = std::tie(std::get<SparseSet<std::remove_const_t<Components>>*>(pools)->Data()...);
+
+			for (size_t begin = 0; begin < count;) {
+				size_t end = count;
+				((end = internal::ContiguousEnd(std::get<typename SparseSet<std::remove_const_t<Components>>::Storage&>(storages), begin, end)), ...);
+
+				Span<const EntityID> ids(entities.data() + begin, end - begin);
+				if constexpr (std::is_invocable_v<Func, Span<const EntityID>, Span<Components>...>) {
+					func(ids, Span<Components>(&std::get<typename SparseSet<std::remove_const_t<Components>>::Storage&>(storages)[begin], end - begin)...);
+				}
+				else {
+					func(Span<Components>(&std::get<typename SparseSet<std::remove_const_t<Components>>::Storage&>(storages)[begin], end - begin)...);
+				}
 
-			BSEECS_ASSERT(bitPos < m_componentPools.size() && bitPos >= 0,
-				"(Internal): Attempting to index into m_componentPools with out of range bit position");
+				([&]() {
+					if constexpr (!std::is_const_v<Components>)
+						std::get<SparseSet<std::remove_const_t<Components>>*>(pools)->MarkChangedRange(begin, end);
+				}(), ...);
 
-			// Downcast the generic pointer to the specific sparse set
-			ISparseSet* genericPtr = m_componentPools[bitPos].get();
-			SparseSet<T>* pool = dynamic_cast<SparseSet<T>*>(genericPtr);
-			BSEECS_ASSERT(pool, "Dynamic cast failed for component pool '" << typeid(T).name() << "'");
+				begin = end;
+			}
+		}
 
-			return *pool;
+		/*
+		*  Sets how many threads ParallelForEach() runs on, including the
+		*  calling one. Defaults to std::thread::hardware_concurrency().
+		*/
+		void SetThreadCount(size_t threadCount) {
+			BSEECS_ASSERT(m_structuralLocks == 0, "Cannot resize the thread pool during ParallelForEach()");
+			m_threadPool = std::make_unique<ThreadPool>(threadCount > 1 ? threadCount - 1 : 0);
 		}
 
+		ThreadPool& GetThreadPool() {
+			if (!m_threadPool)
+				SetThreadCount(std::max(std::thread::hardware_concurrency(), 1u));
+
+			return *m_threadPool;
+		}
 
 		/*
-		*  Creates an entity and returns the ID to refer to that entity.
-		* 
-		*  @param(name): 
-		*  * Optional and used for debugging purposes, it
-		*    shouldn't be used often since there's no optimization 
-		*    in place yet for entities that share a name.
+		*  Same as ForEach(), but splits the dense list of MainComponent into
+		*  chunks processed concurrently on the thread pool. Returns once
+		*  every entity has been visited.
+		*
+		*  The lambda runs on several threads at once, so it must only write
+		*  to the components it is given. Structural changes (creating or
+		*  deleting entities, adding or removing components) assert until the
+		*  call returns; record them in one CommandBuffer per thread instead.
 		*/
-		EntityID CreateEntity(std::string_view name="") {
-			EntityID id = tombstone;
-
-			if (m_availableEntities.size() == 0) {
-				BSEECS_ASSERT(m_maxEntityID < MAX_ENTITIES, "Entity limit exceeded");
-				id = m_maxEntityID++;
+		template <typename MainComponent, typename ...Components, typename Func>
+		void ParallelForEach(Func&& func)
+		{
+			ThreadPool& threadPool = GetThreadPool();
+			bseecs::View<MainComponent, Components...> view = View<MainComponent, Components...>();
+			SparseSet<std::remove_const_t<MainComponent>>& mainPool = GetComponentPool<std::remove_const_t<MainComponent>>();
+
+			// Split at cache line boundaries of the dense list, so no
+			// two chunks write to the same line of MainComponent
+			size_t count = mainPool.Size();
+			size_t elementsPerLine = CACHE_LINE_SIZE / std::gcd(sizeof(MainComponent), CACHE_LINE_SIZE);
+			size_t targetChunk = std::max(count / ((threadPool.WorkerCount() + 1) * CHUNKS_PER_THREAD), MIN_PARALLEL_CHUNK);
+			size_t chunkSize = (targetChunk + elementsPerLine - 1) / elementsPerLine * elementsPerLine;
+
+			size_t misalignment = count > 0 ? reinterpret_cast<uintptr_t>(&mainPool.Data()[0]) % CACHE_LINE_SIZE : 0;
+			size_t firstBoundary = 0;
+			if (misalignment != 0 && (CACHE_LINE_SIZE - misalignment) % sizeof(MainComponent) == 0)
+				firstBoundary = (CACHE_LINE_SIZE - misalignment) / sizeof(MainComponent);
+
+			m_structuralLocks++;
+
+			ThreadPool::TaskGroup group;
+			for (size_t begin = 0; begin < count;) {
+				size_t end = std::min(count, (begin == 0 && firstBoundary != 0) ? firstBoundary : begin + chunkSize);
+				threadPool.Submit(group, [&view, &func, begin, end]() {
+					view.template EachInRange<MainComponent>(begin, end, func);
+				});
+				begin = end;
 			}
-			else {
-				id = m_availableEntities.back();
-				m_availableEntities.pop_back();
+			threadPool.Wait(group);
+
+			m_structuralLocks--;
+		}
+	};
+
+	/*
+	*  Records structural changes so they can be issued while iterating
+	*  with ForEach(), and applies them later in one batch with Playback().
+	* 
+	*  - CreateEntity(name): returns a placeholder ID, usable by the other
+	*    commands of the same buffer and resolved during playback
+	*  - Add<T, RequiredComponents...>(id, component)
+	*  - Remove<T, SustainedComponents...>(id)
+	*  - Set<T>(id, component): overwrites an already attached component
+	*  - DeleteEntity(id)
+	* 
+	*  Playback order is: creations, removals, additions and sets, deletions.
+	*  Removals, additions and sets are grouped by component pool (ordered by
+	*  requirements, so required components are added first and removed last),
+	*  keeping the recording order within a pool. Commands targeting entities
+	*  that are no longer alive at playback are skipped.
+	* 
+	*  Before that, the commands on the same component of the same entity are
+	*  folded so the outcome matches the recording order: an Add() followed by
+	*  a Remove() cancels out, along with the Set()s in between, a Set()
+	*  followed by a Remove() is dropped, and a Remove() followed by an Add()
+	*  replaces the component.
+	*/
+	class CommandBuffer {
+	private:
+
+		// Placeholder IDs returned by CreateEntity() have this index bit set
+		static constexpr EntityIndex PENDING_ENTITY_BIT = EntityIndex(1) << 31;
+		static_assert(MAX_ENTITIES <= PENDING_ENTITY_BIT, "MAX_ENTITIES overlaps CommandBuffer placeholder IDs");
+
+		enum class CommandType : uint8_t {
+			Remove,
+			Add,
+			Set // Played back along with Add
+		};
+
+		using ApplyFunc = void (*)(ECS&, CommandBuffer&, EntityID, size_t);
+
+		struct Command {
+			CommandType m_type;
+			size_t m_typeIndex;
+			EntityID m_id;
+			size_t m_payloadIndex;
+			ApplyFunc m_apply;
+		};
+
+		// Type erased storage of the components recorded by Add()/Set()
+		class IPayload {
+		public:
+			virtual ~IPayload() = default;
+			virtual void Clear() = 0;
+		};
+
+		template <typename T>
+		class Payload : public IPayload {
+		public:
+			std::vector<T> m_values;
+
+			void Clear() override {
+				m_values.clear();
 			}
+		};
 
-			BSEECS_ASSERT(id != tombstone, "Cannot create entity with null ID");
+		std::vector<Command> m_commands;
 
-			if (!name.empty())
-				m_entityNames[id] = name;
+		// Indexed by ComponentTypeIndex<T>()
+		std::vector<std::unique_ptr<IPayload>> m_payloads;
 
-			BSEECS_INFO("Created entity " << ENTITY_INFO(id));
-			return id;
+		std::vector<std::string> m_pendingNames;
+		std::vector<EntityID> m_createdEntities; // Filled during playback
+		std::vector<EntityID> m_deletedEntities;
+
+	private:
+
+		template <typename T>
+		std::vector<T>& GetPayload() {
+			size_t index = ComponentTypeIndex<T>();
+			if (index >= m_payloads.size())
+				m_payloads.resize(index + 1);
+
+			if (!m_payloads[index])
+				m_payloads[index] = std::make_unique<Payload<T>>();
+
+			return static_cast<Payload<T>*>(m_payloads[index].get())->m_values;
 		}
 
-		std::string GetEntityName(EntityID id) {
-			BSEECS_ASSERT_VALID_ENTITY(id);
-			//BSEECS_ASSERT_ALIVE_ENTITY(id);
+		template <typename T>
+		void Record(CommandType type, EntityID id, T&& component, ApplyFunc apply) {
+			std::vector<T>& values = GetPayload<T>();
+			m_commands.push_back({ type, ComponentTypeIndex<T>(), id, values.size(), apply });
+			values.push_back(std::move(component));
+		}
 
-			auto it = m_entityNames.find(id);
-			if (it == m_entityNames.end())
-				return "Entity";
+		template <typename T, typename... RequiredComponents>
+		static void ApplyAdd(ECS& ecs, CommandBuffer& buffer, EntityID id, size_t payloadIndex) {
+			ecs.Add<T, RequiredComponents...>(id, std::move(buffer.GetPayload<T>()[payloadIndex]));
+		}
 
-			return it->second;
+		template <typename T>
+		static void ApplySet(ECS& ecs, CommandBuffer& buffer, EntityID id, size_t payloadIndex) {
+			ecs.Get<T>(id) = std::move(buffer.GetPayload<T>()[payloadIndex]);
+		}
+
+		template <typename T, typename... SustainedComponents>
+		static void ApplyRemove(ECS& ecs, CommandBuffer&, EntityID id, size_t) {
+			ecs.Remove<T, SustainedComponents...>(id);
 		}
 
 		/*
-		* Deletes an active entity and its associated components.
-		* - Overwrites the given entity to NULL_ENTITY.
-		* 
-		* This should NOT be used in the middle of a system while iterating
-		* through entities, as it will remove from the list immediately. Use
-		* FlagEntity(id, true) to mark an entity for deletion, and then DeleteFlagged()
-		* At the end of a frame to clear all flagged entities instead.
+		*  Drops the commands whose effect a later Remove() on the same
+		*  component of the same entity undoes, see the class comment.
 		*/
-		void DeleteEntity(EntityID& id) {
-			BSEECS_ASSERT_VALID_ENTITY(id);
-			//BSEECS_ASSERT_ALIVE_ENTITY(id);
-			
-			std::string name = GetEntityName(id);
+		void FoldCommands() {
+			std::vector<size_t> order(m_commands.size());
+			std::iota(order.begin(), order.end(), size_t(0));
+			std::stable_sort(order.begin(), order.end(), [this](size_t lhs, size_t rhs) {
+				const Command& l = m_commands[lhs];
+				const Command& r = m_commands[rhs];
+				return std::tie(l.m_id, l.m_typeIndex) < std::tie(r.m_id, r.m_typeIndex);
+			});
+
+			for (size_t begin = 0; begin < order.size();) {
+				const Command& first = m_commands[order[begin]];
+				size_t end = begin + 1;
+				while (end < order.size() && m_commands[order[end]].m_id == first.m_id
+					&& m_commands[order[end]].m_typeIndex == first.m_typeIndex)
+					end++;
+
+				// Commands since the previous kept Remove(), in recording order
+				size_t pending = begin;
+				bool added = false;
+				for (size_t i = begin; i < end; i++) {
+					Command& cmd = m_commands[order[i]];
+					if (cmd.m_type != CommandType::Remove) {
+						added |= cmd.m_type == CommandType::Add;
+						continue;
+					}
+
+					for (size_t j = pending; j < i; j++)
+						m_commands[order[j]].m_apply = nullptr;
+
+					// Removing what this buffer added leaves nothing to remove
+					if (added)
+						cmd.m_apply = nullptr;
+
+					pending = i + 1;
+					added = false;
+				}
 
-			m_entityNames.erase(id);
-			m_availableEntities.push_back(id);
+				begin = end;
+			}
 
-			BSEECS_INFO("Deleted entity ['" << name << "', ID: " << id << "]");
-			id = NULL_ENTITY;
+			m_commands.erase(std::remove_if(m_commands.begin(), m_commands.end(),
+				[](const Command& cmd) { return cmd.m_apply == nullptr; }), m_commands.end());
+		}
+
+		EntityID Resolve(EntityID id) const {
+			EntityIndex index = GetEntityIndex(id);
+			if (id == NULL_ENTITY || !(index & PENDING_ENTITY_BIT))
+				return id;
+
+			return m_createdEntities[index & ~PENDING_ENTITY_BIT];
 		}
 
+	public:
+
 		/*
-		*  Register a component with specific required components 
-		*	and create a pool for it
+		*  Records the creation of an entity, the returned placeholder can be
+		*  passed to the other commands of this buffer but not to the ECS.
 		*/
-		template <typename T, typename ...Components>
-		void RegisterComponent() {
-			TypeName name = typeid(T).name();
-			BSEECS_ASSERT(m_componentBitPosition.find(name) == m_componentBitPosition.end(),
-				"Component with name '" << name << "' already registered");
-			BSEECS_ASSERT(m_componentPools.size() < MAX_COMPONENTS,
-				"Exceeded max number of registered components");
+		EntityID CreateEntity(std::string_view name = "") {
+			EntityIndex slot = static_cast<EntityIndex>(m_pendingNames.size());
+			m_pendingNames.emplace_back(name);
+			return MakeEntityID(slot | PENDING_ENTITY_BIT, 0);
+		}
 
-			ComponentMask requiredCompMask = GetMask<Components...>();
+		void DeleteEntity(EntityID id) {
+			m_deletedEntities.push_back(id);
+		}
 
-			ComponentInfo& current = m_componentBitPosition[name];
-			current.m_bitPosition = m_componentPools.size();
-			current.m_isRequiredInComponents = requiredCompMask;
-			current.m_requiredComponents = ComponentMask();
+		template <typename T, typename... RequiredComponents>
+		void Add(EntityID id, T&& component = {}) {
+			Record<T>(CommandType::Add, id, std::move(component), &ApplyAdd<T, RequiredComponents...>);
+		}
 
-			m_componentPools.push_back(std::make_unique<SparseSet<T>>());
+		template <typename T>
+		void Set(EntityID id, T&& component) {
+			Record<T>(CommandType::Set, id, std::move(component), &ApplySet<T>);
+		}
 
-			// Hello I require you, so beware when you be removed
-			BroadcastRequirements<T, Components...>();
+		template <typename T, typename... SustainedComponents>
+		void Remove(EntityID id) {
+			m_commands.push_back({ CommandType::Remove, ComponentTypeIndex<T>(), id, 0,
+				&ApplyRemove<T, SustainedComponents...> });
+		}
 
-			BSEECS_INFO("Registered component '" << name << "'");
+		bool IsEmpty() const {
+			return m_commands.empty() && m_pendingNames.empty() && m_deletedEntities.empty();
 		}
 
 		/*
-		*  Attaches a component to an entity
-		* 
-		* - AddComponent<Transform>(player, {x, y, z});
+		*  Applies every recorded command to the ECS and clears the buffer.
+		*  Must not be called while iterating through the ECS.
 		*/
-		template <typename T, typename... RequiredComponents>
-		T& Add(EntityID id, T&& component={}) {
-			BSEECS_ASSERT_VALID_ENTITY(id);
-			//BSEECS_ASSERT_ALIVE_ENTITY(id);
+		void Playback(ECS& ecs) {
+			for (const std::string& name : m_pendingNames)
+				m_createdEntities.push_back(ecs.CreateEntity(name));
 
-			// Do this first so component pool gets registered before Has<T>()
-			SparseSet<T>& pool = GetComponentPool<T>(true);
+			FoldCommands();
 
-			BSEECS_ASSERT(!pool.Get(id),
-				ENTITY_INFO(id) << " already has component '" << typeid(T).name() << "' added");
+			auto sortKey = [&ecs](const Command& cmd) {
+				size_t depth = ecs.m_componentInfos[cmd.m_typeIndex].m_requirementDepth;
 
+				// Dependent components must be removed before the ones they require
+				if (cmd.m_type == CommandType::Remove)
+					depth = MAX_COMPONENTS - depth;
 
-			ComponentMask incomingCompMask = GetMask<RequiredComponents...>();
-			ComponentMask requiredCompMask = *GetRequiredComponent<T>();
-			ComponentMask resultDiff = incomingCompMask ^ requiredCompMask;
-			BSEECS_ASSERT(resultDiff.none(),
-				typeid(T).name() << " required components mismatch");
+				CommandType type = cmd.m_type == CommandType::Set ? CommandType::Add : cmd.m_type;
+				return std::make_tuple(type, depth, cmd.m_typeIndex);
+			};
 
-			// What about checking and then add if not present
-			bool requiredSatisfied = HasAllRequired<RequiredComponents...>(id);
-			BSEECS_ASSERT(requiredSatisfied,
-				ENTITY_INFO(id) << " is missing some required components ");
+			std::stable_sort(m_commands.begin(), m_commands.end(),
+				[&sortKey](const Command& lhs, const Command& rhs) {
+					return sortKey(lhs) < sortKey(rhs);
+				});
 
-			BSEECS_INFO("Attached '" << typeid(T).name() << "' to " << ENTITY_INFO(id));
-			return *pool.Set(id, std::move(component));
+			for (const Command& cmd : m_commands) {
+				EntityID id = Resolve(cmd.m_id);
+				if (ecs.IsAlive(id))
+					cmd.m_apply(ecs, *this, id, cmd.m_payloadIndex);
+			}
+
+			for (EntityID deleted : m_deletedEntities) {
+				EntityID id = Resolve(deleted);
+				if (ecs.IsAlive(id))
+					ecs.DeleteEntity(id);
+			}
+
+			Clear();
 		}
 
 		/*
-		*  Retrieves the specified component for the given entity
-		* 
-		* - ecs.GetComponent<Transform>(player);
+		*  Drops every recorded command, keeping the allocated memory
 		*/
-		template <typename T>
-		T& Get(EntityID id) {
-			BSEECS_ASSERT_VALID_ENTITY(id);
-
-			SparseSet<T>& pool = GetComponentPool<T>();
-			T* component = pool.Get(id);
-			BSEECS_ASSERT(component,
-				ENTITY_INFO(id) << " missing component 'in " << typeid(T).name() << "' pool");
+		void Clear() {
+			m_commands.clear();
+			for (std::unique_ptr<IPayload>& payload : m_payloads) {
+				if (payload)
+					payload->Clear();
+			}
 
-			return *component;
+			m_pendingNames.clear();
+			m_createdEntities.clear();
+			m_deletedEntities.clear();
 		}
+	};
 
-		/*
-		*  Removes a component from an entity
-		* 
-		* - ecs.RemoveComponent<Transform>(player);
-		*/
-		template <typename T, typename... SustainedComponents>
-		void Remove(EntityID id) {
-			BSEECS_ASSERT_VALID_ENTITY(id);
+	/*
+	*  Runs a list of systems once per frame with Run(ecs), concurrently
+	*  on the ECS thread pool whenever they don't conflict.
+	* 
+	*  Systems declare the components they access: 'const T' for read only,
+	*  'T' for read/write. Two systems conflict when one of them writes a
+	*  component the other accesses. Each frame a dependency graph is built
+	*  where conflicting systems run in the order they were added, every
+	*  other pair of systems may run at the same time.
+	* 
+	*  Systems follow one of two forms:
+	*  - AddSystem<Transform, const Velocity>("Move",
+	*        [](Transform& t, const Velocity& v) { ... });
+	*    Runs through ForEach() on the declared components.
+	*  - AddSystem<const Health>("Reap",
+	*        [](ECS& ecs, CommandBuffer& commands) { ... });
+	*    Runs once, must only access the declared components.
+	* 
+	*  Structural changes assert while systems run. Each system records them
+	*  in its own CommandBuffer, played back in system order after the frame.
+	* 
+	*  Query terms are accepted as well, e.g. AddSystem<Changed<const Transform>, Grid>,
+	*  whose Changed/Added terms only match what changed since the end of
+	*  the system's previous run.
+	*/
+	class Scheduler {
+	private:
 
-			SparseSet<T>& pool = GetComponentPool<T>();
-			BSEECS_ASSERT(pool.Get(id),
-				ENTITY_INFO(id) << " has no component '" << typeid(T).name() << "' to remove");
+		using SystemFunc = std::function<void(ECS&, CommandBuffer&)>;
 
-			ComponentMask incomingCompMask = GetMask<SustainedComponents...>();
-			ComponentMask sustainedCompMask = *GetSustainedComponent<T>();
-			ComponentMask resultDiff = incomingCompMask ^ sustainedCompMask;
-			BSEECS_ASSERT(resultDiff.none(),
-				typeid(T).name() << " sustained components mismatch");
+		struct System {
+			std::string m_name;
+			ComponentMask m_reads;
+			ComponentMask m_writes;
+			SystemFunc m_func;
+			CommandBuffer m_commands;
 
-			// What about checking and then add if not present
-			bool allSustainedRemoved = HasRemovedAll<SustainedComponents...>(id);
-			BSEECS_ASSERT(allSustainedRemoved,
-				ENTITY_INFO(id) << " Delete first all sustained components ");
+			// Clock tick at the end of the previous run, the default
+			// of Changed/Added terms during the next one
+			Tick m_lastRunTick = 0;
 
-			pool.Delete(id);
-			BSEECS_INFO("Removed '" << typeid(T).name() << "' from " << ENTITY_INFO(id));
+			// Systems that must wait for this one, and how many
+			// systems this one waits for
+			std::vector<size_t> m_dependents;
+			size_t m_dependencyCount = 0;
+			std::atomic<size_t> m_pendingDependencies{ 0 };
+		};
+
+		std::vector<std::unique_ptr<System>> m_systems;
+
+		// Query terms map to their components, excluded ones are only read
+		template <typename... Includes, typename... Excludes, typename... Optionals>
+		static void SetAccessBits(System& system, std::tuple<Includes...>*, std::tuple<Excludes...>*, std::tuple<Optionals...>*) {
+			(SetAccessBit<Includes>(system), ...);
+			(SetAccessBit<const Excludes>(system), ...);
+			(SetAccessBit<Optionals>(system), ...);
 		}
 
 		template <typename T>
-		bool Has(EntityID id) {
-			SparseSet<T>& pool = GetComponentPool<T>();
-			return pool.Get(id) ? true : false;
+		static void SetAccessBit(System& system) {
+			size_t bitPos = ComponentTypeIndex<std::remove_const_t<T>>();
+			BSEECS_ASSERT(bitPos < MAX_COMPONENTS,
+				"Exceeded max number of component types, '" << typeid(T).name() << "' cannot be accessed");
+
+			if constexpr (std::is_const_v<T>)
+				system.m_reads.set(bitPos);
+			else
+				system.m_writes.set(bitPos);
 		}
 
-		template <typename... Ts>
-		bool HasAll(EntityID id) {
-			// Fold operator, reads as 
-			// (HasComponent<Transform> && HasComponent<Physics> && HasComponent<Sprite> && ...)
-			return (Has<Ts>(id) && ...);
+		static bool Conflicts(const System& lhs, const System& rhs) {
+			ComponentMask lhsAccess = lhs.m_reads | lhs.m_writes;
+			ComponentMask rhsAccess = rhs.m_reads | rhs.m_writes;
+			return (lhs.m_writes & rhsAccess).any() || (rhs.m_writes & lhsAccess).any();
 		}
 
-		template <typename T>
-		bool HasRequired(EntityID id)
-		{
-			SparseSet<T>& pool = GetComponentPool<T>();
-			T* hasId = pool.Get(id);
-
-			BSEECS_ASSERT(hasId,
-				ENTITY_INFO(id) << " has no REQUIRED component '" << typeid(T).name());
+		void BuildGraph() {
+			for (std::unique_ptr<System>& system : m_systems) {
+				system->m_dependents.clear();
+				system->m_dependencyCount = 0;
+			}
 
-			return hasId;
-		}
+			for (size_t i = 0; i < m_systems.size(); i++) {
+				for (size_t j = i + 1; j < m_systems.size(); j++) {
+					if (!Conflicts(*m_systems[i], *m_systems[j]))
+						continue;
 
-		template <typename... Ts>
-		bool HasAllRequired(EntityID id)
-		{
-			// Fold operator, reads as 
-			// (HasRequired<Transform> && HasRequired<Physics> && HasRequired<Sprite> && ...)
-			return (HasRequired<Ts>(id) && ...);
+					m_systems[i]->m_dependents.push_back(j);
+					m_systems[j]->m_dependencyCount++;
+				}
+			}
 		}
 
-		template <typename T>
-		bool HasRemoved(EntityID id)
-		{
-			SparseSet<T>& pool = GetComponentPool<T>();
-			T* hasId = pool.Get(id);
+		void Launch(ECS& ecs, ThreadPool& threadPool, ThreadPool::TaskGroup& group, size_t index) {
+			threadPool.Submit(group, [this, &ecs, &threadPool, &group, index]() {
+				System& system = *m_systems[index];
 
-			bool ret = hasId ? false : true;
+				// Restored after, Wait() may run another system on this thread
+				Tick previousTick = ECS::s_systemLastRunTick;
+				ECS::s_systemLastRunTick = system.m_lastRunTick;
+				system.m_func(ecs, system.m_commands);
+				ECS::s_systemLastRunTick = previousTick;
 
-			BSEECS_ASSERT(ret,
-				ENTITY_INFO(id) << " has to remove component '" << typeid(T).name());
+				// Its own writes are stamped up to this tick, later ones after it
+				system.m_lastRunTick = ecs.AdvanceTick() - 1;
 
-			return ret;
+				for (size_t dependent : system.m_dependents) {
+					if (m_systems[dependent]->m_pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+						Launch(ecs, threadPool, group, dependent);
+				}
+			});
 		}
 
-		template <typename... Ts>
-		bool HasRemovedAll(EntityID id)
-		{
-			// Fold operator, reads as 
-			// (HasRequired<Transform> && HasRequired<Physics> && HasRequired<Sprite> && ...)
-			return (HasRemoved<Ts>(id) && ...);
-		}
+	public:
 
-		template <typename TDense, typename T>
-		T& GetSibiling(EntityID DenseID)
-		{
-			EntityID EntId = GetComponentPool<TDense>().GetEntity(DenseID);
-			return GetComponentPool<T>().GetRef(EntId);
+		/*
+		*  Adds a system running after every conflicting system added before it.
+		*  See the class description for the accepted function forms.
+		*/
+		template <typename... Access, typename Func>
+		void AddSystem(std::string_view name, Func&& func) {
+			auto system = std::make_unique<System>();
+			system->m_name = name;
+			using Terms = internal::QueryTerms<Access...>;
+			SetAccessBits(*system, static_cast<typename Terms::Includes*>(nullptr),
+				static_cast<typename Terms::Excludes*>(nullptr), static_cast<typename Terms::Optionals*>(nullptr));
+
+			if constexpr (std::is_invocable_v<Func, ECS&, CommandBuffer&>)
+			{
+				system->m_func = std::forward<Func>(func);
+			}
+
+			else
+			{
+				static_assert(sizeof...(Access) > 0, "Per entity systems must declare at least one component");
+				system->m_func = [func = std::forward<Func>(func)](ECS& ecs, CommandBuffer&) mutable {
+					ecs.ForEach<Access...>(func);
+				};
+			}
+
+			m_systems.push_back(std::move(system));
 		}
 
-		template <typename T>
-		T& GetSibiling(const SparseSet<T>& DensCompPool, EntityID DenseID)
-		{
-			EntityID EntId = DensCompPool.GetEntity(DenseID);
-			return GetComponentPool<T>().GetRef(EntId);
+		size_t SystemCount() const {
+			return m_systems.size();
 		}
 
 		/*
-		*  Executes a passed lambda on all the entities that match the
-		*  passed parameter pack.
-		*
-		*  Provided function should follow one of two forms:
-		*  Provided function should follow one of two forms:
-		*  [](Component& c1, Component& c2);
-		*	The Main Component will be used to access the dense data
-		*	and extract the entity ID for the others.
+		*  Runs every system once and returns when all of them are done,
+		*  then plays back their command buffers in the order systems were added.
 		*/
-		template <typename MainComponent, typename ...Components, typename Func>
-		void ForEach(Func&& func)
-		{
-			auto& compPool = GetComponentPool<MainComponent>();
-			auto& dense = compPool.Data();
-			//for (EntityID id : ids.Data())
-			for (size_t i = 0; i < dense.size(); i++)
-			{
-				EntityID id = compPool.GetEntity(i);
-				// This branch is for [](EntityID id, Component& c1, Component& c2);
-				// constexpr denotes this is evaluated at compile time, which allows
-				// the calling of func with different parameters.
-				if constexpr (std::is_invocable_v<Func, EntityID, MainComponent&, Components&...>)
-				{
-					func(id, dense[i], GetComponentPool<Components>().GetRef(id)...);
-				}
+		void Run(ECS& ecs) {
+			BuildGraph();
 
-				// This branch is for [](Component& c1, Component& c2);
-				else if constexpr (std::is_invocable_v<Func, MainComponent&, Components&...>)
-				{
-					func(dense[i], GetComponentPool<Components>().GetRef(id)...);
-				}
+			ThreadPool& threadPool = ecs.GetThreadPool();
+			ecs.m_structuralLocks++;
 
-				else
-				{
-					BSEECS_ASSERT(false,
-						"Bad lambda provided to .ForEach(), parameter pack does not match lambda args");
-				}
+			ThreadPool::TaskGroup group;
+			for (std::unique_ptr<System>& system : m_systems)
+				system->m_pendingDependencies.store(system->m_dependencyCount, std::memory_order_relaxed);
+
+			for (size_t i = 0; i < m_systems.size(); i++) {
+				if (m_systems[i]->m_dependencyCount == 0)
+					Launch(ecs, threadPool, group, i);
 			}
+			threadPool.Wait(group);
+
+			ecs.m_structuralLocks--;
+
+			for (std::unique_ptr<System>& system : m_systems)
+				system->m_commands.Playback(ecs);
 		}
 	};
 
@@ -666,7 +4300,7 @@ namespace bseecs {
 		}
 	protected:
 		ECS& m_Ecs;
-		std::vector<MainComponent>& m_MainDense;
+		typename SparseSet<MainComponent>::Storage& m_MainDense;
 		SparseSet<MainComponent>& m_MainComps;
 	};
 